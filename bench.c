@@ -0,0 +1,786 @@
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "olive.c"
+
+#define BACKGROUND_COLOR 0xFF202020
+#define FOREGROUND_COLOR 0xFF2020FF
+
+// How long every measurement keeps repeating its workload
+#define BENCH_SECONDS 0.25
+
+typedef struct
+{
+    const char *name;
+    size_t width;
+    size_t height;
+} Bench_Size;
+
+Bench_Size bench_sizes[] = {
+    {"1080p", 1920, 1080},
+    {"4K", 3840, 2160},
+    {"8K", 7680, 4320},
+    {"16K", 15360, 8640},
+};
+#define BENCH_SIZES_COUNT (sizeof(bench_sizes) / sizeof(bench_sizes[0]))
+
+double now_secs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+Olivec_Canvas alloc_canvas(size_t width, size_t height)
+{
+    Olivec_Canvas oc = olivec_canvas_alloc(width, height, 0);
+    if (oc.pixels == NULL)
+    {
+        fprintf(stderr, "ERROR: could not allocate %zux%zu pixels\n", width, height);
+        exit(1);
+    }
+    // Touch every page up front so the first measurement does not pay for the page faults
+    memset(oc.pixels, 0, oc.height * oc.stride * sizeof(uint32_t));
+    return oc;
+}
+
+void bench_fill(void)
+{
+    printf("olivec_fill, simd: %s, stream threshold: %zu bytes\n", olivec_simd_name(olivec_simd_use(olivec_simd_detect())), olivec_stream_threshold);
+
+    size_t threshold = olivec_stream_threshold;
+    for (size_t i = 0; i < BENCH_SIZES_COUNT; ++i)
+    {
+        Bench_Size size = bench_sizes[i];
+        Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+        double bytes = (double)(size.width * size.height * sizeof(uint32_t));
+
+        double rates[2];
+        for (int streaming = 0; streaming < 2; ++streaming)
+        {
+            olivec_stream_threshold = streaming ? 0 : SIZE_MAX;
+            size_t iterations = 0;
+            double start = now_secs();
+            double elapsed = 0;
+            do
+            {
+                olivec_fill(oc, iterations % 2 ? BACKGROUND_COLOR : FOREGROUND_COLOR);
+                iterations += 1;
+                elapsed = now_secs() - start;
+            } while (elapsed < BENCH_SECONDS);
+            rates[streaming] = bytes * iterations / elapsed;
+        }
+
+        printf("    %-6s %6.1f MiB  temporal %6.2f GB/s  streaming %6.2f GB/s  -> %s\n",
+               size.name, bytes / (1024 * 1024), rates[0] * 1e-9, rates[1] * 1e-9,
+               rates[1] > rates[0] ? "stream" : "cache");
+        olivec_canvas_free(oc);
+    }
+    olivec_stream_threshold = threshold;
+}
+
+void bench_threads(void)
+{
+    Bench_Size size = bench_sizes[2];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+    double bytes = (double)(size.width * size.height * sizeof(uint32_t));
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("olivec_fill %s across threads, %ld cpus online\n", size.name, cpus);
+    for (long threads = 1; threads <= cpus; threads *= 2)
+    {
+        olivec_threads_start((size_t)threads - 1);
+        size_t iterations = 0;
+        double start = now_secs();
+        double elapsed = 0;
+        do
+        {
+            olivec_fill(oc, iterations % 2 ? BACKGROUND_COLOR : FOREGROUND_COLOR);
+            iterations += 1;
+            elapsed = now_secs() - start;
+        } while (elapsed < BENCH_SECONDS);
+        printf("    %3ld threads %6.2f GB/s\n", threads, bytes * iterations / elapsed * 1e-9);
+    }
+    olivec_threads_stop();
+    olivec_canvas_free(oc);
+}
+
+#define BENCH_RECTS_COUNT 20000
+
+void bench_rects(void)
+{
+    Bench_Size size = bench_sizes[1];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // A dashboard: table cells scattered over the screen, most of them small
+    static Olivec_Rect rects[BENCH_RECTS_COUNT];
+    static uint32_t colors[BENCH_RECTS_COUNT];
+    srand(69);
+    for (size_t i = 0; i < BENCH_RECTS_COUNT; ++i)
+    {
+        rects[i].x = rand() % (int)size.width;
+        rects[i].y = rand() % (int)size.height;
+        rects[i].w = 8 + rand() % 64;
+        rects[i].h = 8 + rand() % 24;
+        colors[i] = 0xFF000000 | (uint32_t)rand();
+    }
+
+    printf("%d rects on %s\n", BENCH_RECTS_COUNT, size.name);
+    double rates[2];
+    for (int batched = 0; batched < 2; ++batched)
+    {
+        size_t iterations = 0;
+        double start = now_secs();
+        double elapsed = 0;
+        do
+        {
+            if (batched)
+            {
+                olivec_fill_rects(oc, rects, colors, BENCH_RECTS_COUNT);
+            }
+            else
+            {
+                for (size_t i = 0; i < BENCH_RECTS_COUNT; ++i)
+                    olivec_fill_rect(oc, rects[i].x, rects[i].y, rects[i].w, rects[i].h, colors[i]);
+            }
+            iterations += 1;
+            elapsed = now_secs() - start;
+        } while (elapsed < BENCH_SECONDS);
+        rates[batched] = BENCH_RECTS_COUNT * iterations / elapsed;
+    }
+    printf("    olivec_fill_rect  %8.2f Mrects/s\n", rates[0] * 1e-6);
+    printf("    olivec_fill_rects %8.2f Mrects/s (x%.2f)\n", rates[1] * 1e-6, rates[1] / rates[0]);
+    olivec_canvas_free(oc);
+}
+
+#define BENCH_CIRCLES_COUNT 10000
+
+// The per pixel bounding square test olivec_fill_circle used before it switched to spans, kept as the baseline
+void fill_circle_per_pixel(Olivec_Canvas oc, int cx, int cy, int r, uint32_t color)
+{
+    for (int y = cy - r; y <= cy + r; ++y)
+    {
+        if (0 <= y && y < (int)oc.height)
+        {
+            for (int x = cx - r; x <= cx + r; ++x)
+            {
+                if (0 <= x && x < (int)oc.width)
+                {
+                    int dx = x - cx;
+                    int dy = y - cy;
+                    if ((int64_t)dx * dx + (int64_t)dy * dy <= (int64_t)r * r)
+                        OLIVEC_PIXEL(oc, x, y) = color;
+                }
+            }
+        }
+    }
+}
+
+void bench_circles(void)
+{
+    // Once the canvas falls out of the cache every row of a circle is a miss, whichever way it is filled
+    Bench_Size sizes[] = {{"VGA", 640, 480}, bench_sizes[1]};
+
+    static int xs[BENCH_CIRCLES_COUNT];
+    static int ys[BENCH_CIRCLES_COUNT];
+    static int rs[BENCH_CIRCLES_COUNT];
+    static uint32_t colors[BENCH_CIRCLES_COUNT];
+
+    printf("%d circles\n", BENCH_CIRCLES_COUNT);
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        Bench_Size size = sizes[s];
+        Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+        // A scatter plot: lots of small markers and a few big bubbles
+        srand(420);
+        for (size_t i = 0; i < BENCH_CIRCLES_COUNT; ++i)
+        {
+            xs[i] = rand() % (int)size.width;
+            ys[i] = rand() % (int)size.height;
+            rs[i] = i % 100 == 0 ? 50 + rand() % 150 : 2 + rand() % 14;
+            colors[i] = 0xFF000000 | (uint32_t)rand();
+        }
+
+        // 0: the per pixel baseline, 1: olivec_fill_circle, 2: olivec_fill_circle_aa
+        double rates[3];
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            size_t iterations = 0;
+            double start = now_secs();
+            double elapsed = 0;
+            do
+            {
+                for (size_t i = 0; i < BENCH_CIRCLES_COUNT; ++i)
+                {
+                    if (mode == 0)
+                        fill_circle_per_pixel(oc, xs[i], ys[i], rs[i], colors[i]);
+                    else if (mode == 1)
+                        olivec_fill_circle(oc, xs[i], ys[i], rs[i], colors[i]);
+                    else
+                        olivec_fill_circle_aa(oc, xs[i], ys[i], rs[i], colors[i]);
+                }
+                iterations += 1;
+                elapsed = now_secs() - start;
+            } while (elapsed < BENCH_SECONDS);
+            rates[mode] = BENCH_CIRCLES_COUNT * iterations / elapsed;
+        }
+        printf("    %-6s per pixel %6.2f  olivec_fill_circle %6.2f (x%.2f)  olivec_fill_circle_aa %6.2f Mcircles/s\n",
+               size.name, rates[0] * 1e-6, rates[1] * 1e-6, rates[1] / rates[0], rates[2] * 1e-6);
+        olivec_canvas_free(oc);
+    }
+    printf("    span cache: %zu hits, %zu misses\n", olivec_span_cache.hits, olivec_span_cache.misses);
+}
+
+#define BENCH_PARTICLES_COUNT (1000 * 1000)
+
+void bench_particles(void)
+{
+    Bench_Size size = bench_sizes[1];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // Separate arrays, the way a particle system keeps its state
+    int *xs = malloc(BENCH_PARTICLES_COUNT * sizeof(*xs));
+    int *ys = malloc(BENCH_PARTICLES_COUNT * sizeof(*ys));
+    int *rs = malloc(BENCH_PARTICLES_COUNT * sizeof(*rs));
+    uint32_t *colors = malloc(BENCH_PARTICLES_COUNT * sizeof(*colors));
+    if (xs == NULL || ys == NULL || rs == NULL || colors == NULL)
+    {
+        fprintf(stderr, "ERROR: could not allocate %d particles\n", BENCH_PARTICLES_COUNT);
+        exit(1);
+    }
+    srand(1337);
+    for (size_t i = 0; i < BENCH_PARTICLES_COUNT; ++i)
+    {
+        xs[i] = rand() % (int)size.width;
+        ys[i] = rand() % (int)size.height;
+        rs[i] = 1 + rand() % 4;
+        colors[i] = 0xFF000000 | (uint32_t)rand();
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%d particles on %s, %ld cpus online\n", BENCH_PARTICLES_COUNT, size.name, cpus);
+    for (int batched = 0; batched < 2; ++batched)
+    {
+        for (long threads = 1; threads <= (batched ? cpus : 1); threads *= 2)
+        {
+            olivec_threads_start((size_t)threads - 1);
+            size_t iterations = 0;
+            double start = now_secs();
+            double elapsed = 0;
+            do
+            {
+                if (batched)
+                {
+                    olivec_fill_circles(oc, xs, ys, rs, colors, BENCH_PARTICLES_COUNT);
+                }
+                else
+                {
+                    for (size_t i = 0; i < BENCH_PARTICLES_COUNT; ++i)
+                        olivec_fill_circle(oc, xs[i], ys[i], rs[i], colors[i]);
+                }
+                iterations += 1;
+                elapsed = now_secs() - start;
+            } while (elapsed < BENCH_SECONDS);
+            printf("    %-19s %3ld threads %8.2f Mcircles/s\n", batched ? "olivec_fill_circles" : "olivec_fill_circle",
+                   threads, BENCH_PARTICLES_COUNT * iterations / elapsed * 1e-6);
+        }
+    }
+    olivec_threads_stop();
+
+    free(xs);
+    free(ys);
+    free(rs);
+    free(colors);
+    olivec_canvas_free(oc);
+}
+
+#define BENCH_CULLING_COUNT 20000
+
+typedef enum
+{
+    CULLING_CIRCLE,
+    CULLING_RING,
+    CULLING_ELLIPSE,
+    CULLING_TRIANGLE,
+    CULLING_LINE,
+    CULLING_OUTLINE,
+    COUNT_CULLING_KINDS,
+} Culling_Kind;
+
+const char *culling_kind_names[COUNT_CULLING_KINDS] = {
+    [CULLING_CIRCLE] = "fill_circle",
+    [CULLING_RING] = "fill_ring",
+    [CULLING_ELLIPSE] = "fill_ellipse",
+    [CULLING_TRIANGLE] = "fill_triangle",
+    [CULLING_LINE] = "draw_line",
+    [CULLING_OUTLINE] = "draw_circle",
+};
+
+void culling_draw(Olivec_Canvas oc, Culling_Kind kind, const int *v, uint32_t color)
+{
+    switch (kind)
+    {
+    case CULLING_CIRCLE:
+        olivec_fill_circle(oc, v[0], v[1], v[2], color);
+        break;
+    case CULLING_RING:
+        olivec_fill_ring(oc, v[0], v[1], v[2] / 2, v[2], color);
+        break;
+    case CULLING_ELLIPSE:
+        olivec_fill_ellipse(oc, v[0], v[1], v[2], v[3] / 2, color);
+        break;
+    case CULLING_TRIANGLE:
+        olivec_fill_triangle(oc, v[0], v[1], v[0] + v[2], v[1] + v[3], v[0] - v[3], v[1] + v[2], color);
+        break;
+    case CULLING_LINE:
+        olivec_draw_line(oc, v[0], v[1], v[0] + 3 * v[2], v[1] + 2 * v[3], color);
+        break;
+    case CULLING_OUTLINE:
+        olivec_draw_circle(oc, v[0], v[1], v[2], color);
+        break;
+    default:
+        break;
+    }
+}
+
+void bench_culling(void)
+{
+    Bench_Size size = bench_sizes[0];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // A map zoomed in on one 1/16th of its area: the shapes are spread over a world four times the canvas in either
+    // direction, so most of them are culled. The inside set is the same shapes moved onto the canvas.
+    static int outside[BENCH_CULLING_COUNT][4];
+    static int inside[BENCH_CULLING_COUNT][4];
+    srand(777);
+    for (size_t i = 0; i < BENCH_CULLING_COUNT; ++i)
+    {
+        int r = 10 + rand() % 50;
+        int s = 10 + rand() % 50;
+        int x, y;
+        do
+        {
+            x = rand() % (int)(4 * size.width) - (int)(3 * size.width / 2);
+            y = rand() % (int)(4 * size.height) - (int)(3 * size.height / 2);
+        } while (x > -200 && x < (int)size.width + 200 && y > -200 && y < (int)size.height + 200);
+        outside[i][0] = x;
+        outside[i][1] = y;
+        outside[i][2] = r;
+        outside[i][3] = s;
+        inside[i][0] = 100 + rand() % ((int)size.width - 200);
+        inside[i][1] = 100 + rand() % ((int)size.height - 200);
+        inside[i][2] = r;
+        inside[i][3] = s;
+    }
+
+    printf("%d shapes on %s, completely outside vs completely inside\n", BENCH_CULLING_COUNT, size.name);
+    for (Culling_Kind kind = 0; kind < COUNT_CULLING_KINDS; ++kind)
+    {
+        double ns[2];
+        for (int visible = 0; visible < 2; ++visible)
+        {
+            size_t iterations = 0;
+            double start = now_secs();
+            double elapsed = 0;
+            do
+            {
+                for (size_t i = 0; i < BENCH_CULLING_COUNT; ++i)
+                    culling_draw(oc, kind, visible ? inside[i] : outside[i], 0xFF000000 | (uint32_t)i);
+                iterations += 1;
+                elapsed = now_secs() - start;
+            } while (elapsed < BENCH_SECONDS);
+            ns[visible] = elapsed / (BENCH_CULLING_COUNT * iterations) * 1e9;
+        }
+        printf("    %-14s outside %8.1f ns  inside %8.1f ns\n", culling_kind_names[kind], ns[0], ns[1]);
+    }
+    olivec_canvas_free(oc);
+}
+
+#define BENCH_LINES_SERIES 20
+#define BENCH_LINES_POINTS 500
+
+void bench_lines(void)
+{
+    Bench_Size size = bench_sizes[0];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // A chart overlay: a few series of random walks across the whole width, each point joined to the next
+    static int xs[BENCH_LINES_SERIES][BENCH_LINES_POINTS];
+    static int ys[BENCH_LINES_SERIES][BENCH_LINES_POINTS];
+    srand(2024);
+    size_t pixels = 0;
+    for (size_t s = 0; s < BENCH_LINES_SERIES; ++s)
+    {
+        int y = rand() % (int)size.height;
+        for (size_t i = 0; i < BENCH_LINES_POINTS; ++i)
+        {
+            y += rand() % 61 - 30;
+            if (y < 0)
+                y = -y;
+            if (y >= (int)size.height)
+                y = 2 * ((int)size.height - 1) - y;
+            xs[s][i] = (int)(i * (size.width - 1) / (BENCH_LINES_POINTS - 1));
+            ys[s][i] = y;
+            if (i > 0)
+            {
+                int dx = xs[s][i] - xs[s][i - 1];
+                int dy = OLIVEC_ABS(int, ys[s][i] - ys[s][i - 1]);
+                pixels += (size_t)(dx > dy ? dx : dy) + 1;
+            }
+        }
+    }
+
+    size_t lines = BENCH_LINES_SERIES * (BENCH_LINES_POINTS - 1);
+    printf("%zu lines on %s, %zu pixels each on average\n", lines, size.name, pixels / lines);
+    double rates[2];
+    for (int aa = 0; aa < 2; ++aa)
+    {
+        size_t iterations = 0;
+        double start = now_secs();
+        double elapsed = 0;
+        do
+        {
+            for (size_t s = 0; s < BENCH_LINES_SERIES; ++s)
+            {
+                uint32_t color = 0xFF000000 | (uint32_t)(s * 0x0F1D2B);
+                for (size_t i = 1; i < BENCH_LINES_POINTS; ++i)
+                {
+                    if (aa)
+                        olivec_draw_line_aa(oc, xs[s][i - 1], ys[s][i - 1], xs[s][i], ys[s][i], color);
+                    else
+                        olivec_draw_line(oc, xs[s][i - 1], ys[s][i - 1], xs[s][i], ys[s][i], color);
+                }
+            }
+            iterations += 1;
+            elapsed = now_secs() - start;
+        } while (elapsed < BENCH_SECONDS);
+        rates[aa] = pixels * iterations / elapsed;
+        printf("    %-19s %8.2f Mlines/s %6.2f ns/pixel\n", aa ? "olivec_draw_line_aa" : "olivec_draw_line",
+               lines * iterations / elapsed * 1e-6, 1e9 / rates[aa]);
+    }
+    printf("    anti-aliasing costs x%.2f\n", rates[0] / rates[1]);
+    olivec_canvas_free(oc);
+}
+
+#define BENCH_POLYLINE_POINTS 100000
+
+void bench_polyline(void)
+{
+    Bench_Size size = bench_sizes[1];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // A dense time series: far more samples than columns, so most segments are a few pixels long
+    static Olivec_Point points[BENCH_POLYLINE_POINTS];
+    srand(420);
+    int y = (int)size.height / 2;
+    for (size_t i = 0; i < BENCH_POLYLINE_POINTS; ++i)
+    {
+        y += rand() % 41 - 20;
+        if (y < 0)
+            y = -y;
+        if (y >= (int)size.height)
+            y = 2 * ((int)size.height - 1) - y;
+        points[i].x = (int)(i * (size.width - 1) / (BENCH_POLYLINE_POINTS - 1));
+        points[i].y = y;
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    printf("%d point strip on %s, %ld cpus online\n", BENCH_POLYLINE_POINTS, size.name, cpus);
+    const char *names[] = {"olivec_draw_line", "olivec_draw_polyline", "  across threads"};
+    double rates[3];
+    for (int mode = 0; mode < 3; ++mode)
+    {
+        if (mode == 2)
+            olivec_threads_start((size_t)cpus - 1);
+        size_t iterations = 0;
+        double start = now_secs();
+        double elapsed = 0;
+        do
+        {
+            if (mode == 0)
+            {
+                for (size_t i = 1; i < BENCH_POLYLINE_POINTS; ++i)
+                    olivec_draw_line(oc, points[i - 1].x, points[i - 1].y, points[i].x, points[i].y, FOREGROUND_COLOR);
+            }
+            else
+            {
+                olivec_draw_polyline(oc, points, BENCH_POLYLINE_POINTS, FOREGROUND_COLOR);
+            }
+            iterations += 1;
+            elapsed = now_secs() - start;
+        } while (elapsed < BENCH_SECONDS);
+        rates[mode] = (BENCH_POLYLINE_POINTS - 1) * iterations / elapsed;
+        printf("    %-20s %8.2f Msegments/s (x%.2f)\n", names[mode], rates[mode] * 1e-6, rates[mode] / rates[0]);
+    }
+    olivec_threads_stop();
+    olivec_canvas_free(oc);
+}
+
+#define BENCH_GRID_STEP 16
+
+// The general Bresenham path olivec_draw_line took for horizontal and vertical lines before they got their own
+// kernels, kept as the baseline
+void draw_line_bresenham(Olivec_Canvas oc, int x1, int y1, int x2, int y2, uint32_t color)
+{
+    Olivec_Line line;
+    if (olivec_clip_line(oc, x1, y1, x2, y2, &line))
+        olivec_walk_line(&OLIVEC_PIXEL(oc, line.x, line.y), oc.stride, &line, color);
+}
+
+void bench_grid(void)
+{
+    Bench_Size size = bench_sizes[1];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // A table: a rule every BENCH_GRID_STEP pixels in both directions, each overhanging the canvas a little
+    int w = (int)size.width;
+    int h = (int)size.height;
+    printf("grid of %d rows and %d columns on %s\n", h / BENCH_GRID_STEP, w / BENCH_GRID_STEP, size.name);
+    const char *names[] = {"bresenham", "olivec_draw_line"};
+    for (int vertical = 0; vertical < 2; ++vertical)
+    {
+        double rates[2];
+        for (int mode = 0; mode < 2; ++mode)
+        {
+            void (*draw)(Olivec_Canvas, int, int, int, int, uint32_t) = mode ? olivec_draw_line : draw_line_bresenham;
+            size_t iterations = 0;
+            double start = now_secs();
+            double elapsed = 0;
+            do
+            {
+                if (vertical)
+                {
+                    for (int x = 0; x < w; x += BENCH_GRID_STEP)
+                        draw(oc, x, -8, x, h + 8, FOREGROUND_COLOR);
+                }
+                else
+                {
+                    for (int y = 0; y < h; y += BENCH_GRID_STEP)
+                        draw(oc, -8, y, w + 8, y, FOREGROUND_COLOR);
+                }
+                iterations += 1;
+                elapsed = now_secs() - start;
+            } while (elapsed < BENCH_SECONDS);
+            size_t pixels = vertical ? (size_t)(w / BENCH_GRID_STEP) * (size_t)h : (size_t)(h / BENCH_GRID_STEP) * (size_t)w;
+            rates[mode] = pixels * iterations / elapsed;
+            printf("    %-8s %-16s %6.2f ns/pixel (x%.2f)\n", vertical ? "columns" : "rows", names[mode], 1e9 / rates[mode],
+                   rates[mode] / rates[0]);
+        }
+    }
+    olivec_canvas_free(oc);
+}
+
+void bench_dashes(void)
+{
+    Bench_Size size = bench_sizes[0];
+    Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+
+    // The series of bench_lines as strips, drawn solid, dashed and dotted
+    static Olivec_Point points[BENCH_LINES_SERIES][BENCH_LINES_POINTS];
+    srand(2024);
+    size_t pixels = 0;
+    for (size_t s = 0; s < BENCH_LINES_SERIES; ++s)
+    {
+        int y = rand() % (int)size.height;
+        for (size_t i = 0; i < BENCH_LINES_POINTS; ++i)
+        {
+            y += rand() % 61 - 30;
+            if (y < 0)
+                y = -y;
+            if (y >= (int)size.height)
+                y = 2 * ((int)size.height - 1) - y;
+            points[s][i].x = (int)(i * (size.width - 1) / (BENCH_LINES_POINTS - 1));
+            points[s][i].y = y;
+            if (i > 0)
+            {
+                int dx = points[s][i].x - points[s][i - 1].x;
+                int dy = OLIVEC_ABS(int, points[s][i].y - points[s][i - 1].y);
+                pixels += (size_t)(dx > dy ? dx : dy);
+            }
+        }
+    }
+
+    printf("%d strips of %d points on %s\n", BENCH_LINES_SERIES, BENCH_LINES_POINTS, size.name);
+    const char *names[] = {"solid", "dashed 6/4", "dotted"};
+    Olivec_Line_Pattern patterns[] = {{0}, olivec_dash(6, 4), olivec_dash(1, 1)};
+    // The patterns take turns and each keeps its fastest pass, so the host slowing down or speeding up during the run
+    // affects all of them alike
+    double best[3] = {1e9, 1e9, 1e9};
+    double start = now_secs();
+    do
+    {
+        for (int mode = 0; mode < 3; ++mode)
+        {
+            double pass_start = now_secs();
+            for (size_t s = 0; s < BENCH_LINES_SERIES; ++s)
+            {
+                uint32_t color = 0xFF000000 | (uint32_t)(s * 0x0F1D2B);
+                olivec_draw_polyline_pattern(oc, points[s], BENCH_LINES_POINTS, mode ? &patterns[mode] : NULL, color);
+            }
+            double pass = now_secs() - pass_start;
+            if (pass < best[mode])
+                best[mode] = pass;
+        }
+    } while (now_secs() - start < 3 * BENCH_SECONDS);
+    for (int mode = 0; mode < 3; ++mode)
+        printf("    %-10s %6.2f ns/pixel (x%.2f)\n", names[mode], best[mode] * 1e9 / (double)pixels, best[mode] / best[0]);
+    olivec_canvas_free(oc);
+}
+
+// The scanline rasterizer olivec_fill_triangle used before the edge functions, two divisions per row and a canvas
+// check per pixel unless the triangle is inside the canvas, kept as the baseline
+void fill_triangle_sorted(Olivec_Canvas oc, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color)
+{
+    olivec_sort_triangle_points_by_y(&x1, &y1, &x2, &y2, &x3, &y3);
+    int xmin = x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3);
+    int xmax = x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3);
+    Olivec_Clip clip = olivec_clip_bounds(oc, xmin, y1, xmax, y3);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    for (int y = y1; y <= y3; ++y)
+    {
+        if (y < 0 || (size_t)y >= oc.height)
+            continue;
+        int s1 = y <= y2 ? (y2 != y1 ? (int)((int64_t)(y - y1) * (x2 - x1) / (y2 - y1)) + x1 : x1)
+                         : (y2 != y3 ? (int)((int64_t)(y - y3) * (x2 - x3) / (y2 - y3)) + x3 : x3);
+        int s2 = y3 != y1 ? (int)((int64_t)(y - y1) * (x3 - x1) / (y3 - y1)) + x1 : x1;
+        if (s1 > s2)
+            OLIVEC_SWAP(int, s1, s2);
+        for (int x = s1; x <= s2; ++x)
+        {
+            if (clip == OLIVEC_INSIDE || (0 <= x && (size_t)x < oc.width))
+                OLIVEC_PIXEL(oc, x, y) = color;
+        }
+    }
+}
+
+// Grid cell of the mesh of small triangles, whose corners are jittered by up to a quarter of it
+#define BENCH_TRIANGLES_CELL 16
+
+void bench_triangles(void)
+{
+    // The scene of test_fill_triangle at its own size and at 1080p, then a mesh of small triangles covering 1080p
+    Bench_Size sizes[] = {{"128x128", 128, 128}, bench_sizes[0]};
+    for (size_t i = 0; i < 3; ++i)
+    {
+        Bench_Size size = sizes[i < 2 ? i : 1];
+        Olivec_Canvas oc = alloc_canvas(size.width, size.height);
+        int w = (int)size.width;
+        int h = (int)size.height;
+
+        enum {COLS = 1920 / BENCH_TRIANGLES_CELL, ROWS = 1080 / BENCH_TRIANGLES_CELL};
+        static int triangles[2 * COLS * ROWS][6];
+        size_t count = 3;
+        if (i < 2)
+        {
+            int scene[3][6] = {
+                {w / 2, h / 8, w / 8, h / 2, w * 7 / 8, h * 7 / 8},
+                {w / 2, h * 2 / 8, w * 2 / 8, h / 2, w * 6 / 8, h / 2},
+                {w / 8, h / 8, w / 8, h * 3 / 8, w * 3 / 8, h * 3 / 8},
+            };
+            memcpy(triangles, scene, sizeof(scene));
+            printf("test_fill_triangle scene on %s\n", size.name);
+        }
+        else
+        {
+            static Olivec_Point corners[ROWS + 1][COLS + 1];
+            srand(1337);
+            for (int y = 0; y <= ROWS; ++y)
+            {
+                for (int x = 0; x <= COLS; ++x)
+                {
+                    int jitter = BENCH_TRIANGLES_CELL / 4;
+                    corners[y][x].x = x * BENCH_TRIANGLES_CELL + rand() % (2 * jitter + 1) - jitter;
+                    corners[y][x].y = y * BENCH_TRIANGLES_CELL + rand() % (2 * jitter + 1) - jitter;
+                }
+            }
+            count = 0;
+            for (int y = 0; y < ROWS; ++y)
+            {
+                for (int x = 0; x < COLS; ++x)
+                {
+                    Olivec_Point p00 = corners[y][x], p10 = corners[y][x + 1];
+                    Olivec_Point p01 = corners[y + 1][x], p11 = corners[y + 1][x + 1];
+                    int upper[6] = {p00.x, p00.y, p10.x, p10.y, p01.x, p01.y};
+                    int lower[6] = {p10.x, p10.y, p11.x, p11.y, p01.x, p01.y};
+                    memcpy(triangles[count++], upper, sizeof(upper));
+                    memcpy(triangles[count++], lower, sizeof(lower));
+                }
+            }
+            printf("%zu triangles in a %d px mesh on %s\n", count, BENCH_TRIANGLES_CELL, size.name);
+        }
+
+        const char *names[] = {"scanline", "edge functions"};
+        // Interleaved passes keeping the fastest of each, as in bench_dashes
+        double best[2] = {1e9, 1e9};
+        double start = now_secs();
+        do
+        {
+            for (int mode = 0; mode < 2; ++mode)
+            {
+                void (*fill)(Olivec_Canvas, int, int, int, int, int, int, uint32_t) = mode ? olivec_fill_triangle : fill_triangle_sorted;
+                double pass_start = now_secs();
+                for (size_t j = 0; j < count; ++j)
+                {
+                    int *t = triangles[j];
+                    fill(oc, t[0], t[1], t[2], t[3], t[4], t[5], 0xFF000000 | (uint32_t)(j * 0x0F1D2B));
+                }
+                double pass = now_secs() - pass_start;
+                if (pass < best[mode])
+                    best[mode] = pass;
+            }
+        } while (now_secs() - start < 2 * BENCH_SECONDS);
+        for (int mode = 0; mode < 2; ++mode)
+            printf("    %-14s %10.0f ns/frame (x%.2f)\n", names[mode], best[mode] * 1e9, best[0] / best[mode]);
+        olivec_canvas_free(oc);
+    }
+}
+
+typedef struct
+{
+    void (*run)(void);
+    const char *name;
+} Bench_Case;
+
+#define DEFINE_BENCH_CASE(name)  \
+    {                            \
+        bench_##name, #name      \
+    }
+
+Bench_Case bench_cases[] = {
+    DEFINE_BENCH_CASE(fill),
+    DEFINE_BENCH_CASE(threads),
+    DEFINE_BENCH_CASE(rects),
+    DEFINE_BENCH_CASE(circles),
+    DEFINE_BENCH_CASE(particles),
+    DEFINE_BENCH_CASE(culling),
+    DEFINE_BENCH_CASE(lines),
+    DEFINE_BENCH_CASE(polyline),
+    DEFINE_BENCH_CASE(grid),
+    DEFINE_BENCH_CASE(dashes),
+    DEFINE_BENCH_CASE(triangles),
+};
+#define BENCH_CASES_COUNT (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+int main(int argc, char **argv)
+{
+    for (size_t i = 0; i < BENCH_CASES_COUNT; ++i)
+    {
+        bool selected = argc < 2;
+        for (int j = 1; j < argc; ++j)
+        {
+            if (strcmp(argv[j], bench_cases[i].name) == 0)
+                selected = true;
+        }
+        if (selected)
+            bench_cases[i].run();
+    }
+    return 0;
+}
@@ -1,3 +1,4 @@
+#define _DEFAULT_SOURCE
 #include <stdbool.h>
 #include <errno.h>
 #include <string.h>
@@ -20,12 +21,12 @@
 
 #define IMGS_DIR_PATH "./imgs"
 
-// Unsigned 32-bit integer which stores the pixels
-static uint32_t pixels[HEIGHT * WIDTH];
+// Aligned, row-padded canvas the examples draw into, allocated in main()
+static Olivec_Canvas oc;
 
 bool checker_example(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
+    olivec_fill(oc, BACKGROUND_COLOR);
 
     for (int y = 0; y < ROWS; ++y)
     {
@@ -36,14 +37,14 @@ bool checker_example(void)
             {
                 color = 0xFF2020FF;
             }
-            olivec_fill_rect(pixels, WIDTH, HEIGHT, x * CELL_WIDTH, y * CELL_HEIGHT, CELL_WIDTH, CELL_HEIGHT, color);
+            olivec_fill_rect(oc, x * CELL_WIDTH, y * CELL_HEIGHT, CELL_WIDTH, CELL_HEIGHT, color);
         }
     }
 
     const char *file_path = IMGS_DIR_PATH "/checker.png";
     printf("Generated %s\n", file_path);
 
-    if (!stbi_write_png(file_path, WIDTH, HEIGHT, 4, pixels, WIDTH * sizeof(uint32_t)))
+    if (!stbi_write_png(file_path, oc.width, oc.height, 4, oc.pixels, oc.stride * sizeof(uint32_t)))
     {
         fprintf(stderr, "ERROR: could not save file %s: %s\n", file_path, strerror(errno));
         return false;
@@ -59,8 +60,12 @@ float lerpf(float a, float b, float t)
 
 bool circle_example(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
+    olivec_fill(oc, BACKGROUND_COLOR);
 
+    int xs[ROWS * COLS];
+    int ys[ROWS * COLS];
+    int rs[ROWS * COLS];
+    uint32_t colors[ROWS * COLS];
     for (int y = 0; y < ROWS; y++)
     {
         for (int x = 0; x < COLS; x++)
@@ -72,14 +77,20 @@ bool circle_example(void)
             size_t radius = CELL_WIDTH;
             if (CELL_HEIGHT < radius)
                 radius = CELL_HEIGHT;
-            olivec_fill_circle(pixels, WIDTH, HEIGHT, x * CELL_WIDTH + CELL_WIDTH / 2, y * CELL_HEIGHT + CELL_HEIGHT / 2, (size_t)lerpf(radius / 8, radius / 2, t), FOREGROUND_COLOR);
+
+            int i = y * COLS + x;
+            xs[i] = x * CELL_WIDTH + CELL_WIDTH / 2;
+            ys[i] = y * CELL_HEIGHT + CELL_HEIGHT / 2;
+            rs[i] = (int)lerpf(radius / 8, radius / 2, t);
+            colors[i] = FOREGROUND_COLOR;
         }
     }
+    olivec_fill_circles(oc, xs, ys, rs, colors, ROWS * COLS);
 
     const char *file_path = IMGS_DIR_PATH "/circle.png";
     printf("Generated %s\n", file_path);
 
-    if (!stbi_write_png(file_path, WIDTH, HEIGHT, 4, pixels, WIDTH * sizeof(uint32_t)))
+    if (!stbi_write_png(file_path, oc.width, oc.height, 4, oc.pixels, oc.stride * sizeof(uint32_t)))
     {
         fprintf(stderr, "ERROR: could not save file %s: %s\n", file_path, strerror(errno));
         return false;
@@ -90,28 +101,28 @@ bool circle_example(void)
 
 bool lines_example(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
+    olivec_fill(oc, BACKGROUND_COLOR);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, FOREGROUND_COLOR);
+    olivec_draw_line(oc, 0, 0, WIDTH, HEIGHT, FOREGROUND_COLOR);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH, 0, 0, HEIGHT, FOREGROUND_COLOR);
+    olivec_draw_line(oc, WIDTH, 0, 0, HEIGHT, FOREGROUND_COLOR);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, 0, 0, WIDTH / 4, HEIGHT, 0xFF20FF20);
+    olivec_draw_line(oc, 0, 0, WIDTH / 4, HEIGHT, 0xFF20FF20);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH / 4, 0, 0, HEIGHT, 0xFF20FF20);
+    olivec_draw_line(oc, WIDTH / 4, 0, 0, HEIGHT, 0xFF20FF20);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH, 0, WIDTH / 4 * 3, HEIGHT, 0xFF20FF20);
+    olivec_draw_line(oc, WIDTH, 0, WIDTH / 4 * 3, HEIGHT, 0xFF20FF20);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH / 4 * 3, 0, WIDTH, HEIGHT, 0xFF20FF20);
+    olivec_draw_line(oc, WIDTH / 4 * 3, 0, WIDTH, HEIGHT, 0xFF20FF20);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, 0, HEIGHT / 2, WIDTH, HEIGHT / 2, 0xFFFF2020);
+    olivec_draw_line(oc, 0, HEIGHT / 2, WIDTH, HEIGHT / 2, 0xFFFF2020);
 
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH / 2, 0, WIDTH / 2, HEIGHT, 0xFFFF2020);
+    olivec_draw_line(oc, WIDTH / 2, 0, WIDTH / 2, HEIGHT, 0xFFFF2020);
 
     const char *file_path = IMGS_DIR_PATH "/lines.png";
     printf("Generated %s\n", file_path);
 
-    if (!stbi_write_png(file_path, WIDTH, HEIGHT, 4, pixels, WIDTH * sizeof(uint32_t)))
+    if (!stbi_write_png(file_path, oc.width, oc.height, 4, oc.pixels, oc.stride * sizeof(uint32_t)))
     {
         fprintf(stderr, "ERROR: could not save file %s: %s\n", file_path, strerror(errno));
         return false;
@@ -122,6 +133,13 @@ bool lines_example(void)
 
 int main(void)
 {
+    oc = olivec_canvas_alloc(WIDTH, HEIGHT, 0);
+    if (oc.pixels == NULL)
+    {
+        fprintf(stderr, "ERROR: could not allocate %dx%d canvas\n", WIDTH, HEIGHT);
+        return -1;
+    }
+
     if (!checker_example())
         return -1;
     if (!circle_example())
@@ -129,5 +147,6 @@ int main(void)
     if (!lines_example())
         return -1;
 
+    olivec_canvas_free(oc);
     return 0;
 }
\ No newline at end of file
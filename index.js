@@ -27,5 +27,16 @@ WebAssembly.instantiateStreaming(fetch("./wasm.wasm"), {
     const pixels = w.instance.exports.render();
     const image = new ImageData(new Uint8ClampedArray(buffer, pixels, app.width*app.height*4), app.width);
 
-    ctx.putImageData(image, 0, 0);
+    // Upload only the regions that render() reported as changed. A wasm.wasm built before damage tracking has no
+    // damage exports, so it gets the whole frame
+    const exports = w.instance.exports;
+    if (exports.damage_count === undefined || exports.damage_rects === undefined) {
+        ctx.putImageData(image, 0, 0);
+        return;
+    }
+    const count = exports.damage_count();
+    const rects = new Int32Array(buffer, exports.damage_rects(), count*4);
+    for (let i = 0; i < count; ++i) {
+        ctx.putImageData(image, 0, 0, rects[i*4 + 0], rects[i*4 + 1], rects[i*4 + 2], rects[i*4 + 3]);
+    }
 })
@@ -1,8 +1,16 @@
 #ifndef OLIVE_C_
 #define OLIVE_C_
 
+// open(), ftruncate() and mmap() are POSIX, not ISO C, so strict modes like -std=c11 hide them unless asked for. This
+// only works if olive.c comes before any libc header; otherwise the translation unit has to define it (or
+// _DEFAULT_SOURCE) itself
+#if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE) && !defined(_DEFAULT_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #define OLIVEC_SWAP(T, a, b) \
     do                       \
@@ -12,140 +20,3290 @@
         b = t;               \
     } while (0)
 
-#define OLIVEC_SIGN(T, x) ((T)(x > 0) - (T)(x < 0))
+#define OLIVEC_SIGN(T, x) ((T)(x > 0) - (T)(x < 0))
+
+#define OLIVEC_ABS(T, x) (OLIVEC_SIGN(T, x) * (x))
+
+#define OLIVEC_PI 3.14159265358979323846f
+
+#define OLIVEC_RED(color) (((color) & 0x000000FF) >> (8 * 0))
+#define OLIVEC_GREEN(color) (((color) & 0x0000FF00) >> (8 * 1))
+#define OLIVEC_BLUE(color) (((color) & 0x00FF0000) >> (8 * 2))
+#define OLIVEC_ALPHA(color) (((color) & 0xFF000000) >> (8 * 3))
+#define OLIVEC_RGBA(r, g, b, a) ((((uint32_t)(r) & 0xFF) << (8 * 0)) | (((uint32_t)(g) & 0xFF) << (8 * 1)) | (((uint32_t)(b) & 0xFF) << (8 * 2)) | (((uint32_t)(a) & 0xFF) << (8 * 3)))
+
+// The wasm build has no libc, so anything that needs the host (SIMD intrinsics, threads, files) is compiled out
+#if defined(__wasm__) || !__STDC_HOSTED__
+#define OLIVEC_FREESTANDING
+#endif
+
+#if !defined(OLIVEC_FREESTANDING) && !defined(OLIVEC_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OLIVEC_X86
+#include <immintrin.h>
+#endif
+
+#ifndef OLIVEC_FREESTANDING
+#include <stdlib.h>
+#endif
+
+#if !defined(OLIVEC_FREESTANDING) && (defined(__unix__) || defined(__APPLE__))
+#define OLIVEC_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(OLIVEC_POSIX) && !defined(OLIVEC_NO_THREADS)
+#define OLIVEC_THREADS
+#include <pthread.h>
+#endif
+
+typedef enum
+{
+    OLIVEC_SIMD_SCALAR = 0,
+    OLIVEC_SIMD_SSE2,
+    OLIVEC_SIMD_AVX2,
+    OLIVEC_SIMD_AVX512,
+} Olivec_Simd;
+
+void olivec_fill_span_scalar(uint32_t *dst, size_t count, uint32_t color)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        dst[i] = color;
+    }
+}
+
+#ifdef OLIVEC_X86
+// Every vector kernel covers the unaligned head and tail of the span with one unaligned store each, overlapping the
+// aligned stores in between, so short spans cost a couple of instructions instead of a scalar loop
+
+__attribute__((target("sse2"))) void olivec_fill_span_sse2(uint32_t *dst, size_t count, uint32_t color)
+{
+    if (count < 4)
+    {
+        for (size_t i = 0; i < count; ++i)
+            dst[i] = color;
+        return;
+    }
+
+    __m128i v = _mm_set1_epi32((int)color);
+    uint32_t *end = dst + count;
+    _mm_storeu_si128((__m128i *)dst, v);
+
+    uint32_t *p = (uint32_t *)(((uintptr_t)dst + 16) & ~(uintptr_t)15);
+    for (; p + 16 <= end; p += 16)
+    {
+        _mm_store_si128((__m128i *)(p + 0), v);
+        _mm_store_si128((__m128i *)(p + 4), v);
+        _mm_store_si128((__m128i *)(p + 8), v);
+        _mm_store_si128((__m128i *)(p + 12), v);
+    }
+    for (; p + 4 <= end; p += 4)
+        _mm_store_si128((__m128i *)p, v);
+
+    _mm_storeu_si128((__m128i *)(end - 4), v);
+}
+
+__attribute__((target("avx2"))) void olivec_fill_span_avx2(uint32_t *dst, size_t count, uint32_t color)
+{
+    if (count < 8)
+    {
+        olivec_fill_span_sse2(dst, count, color);
+        return;
+    }
+
+    __m256i v = _mm256_set1_epi32((int)color);
+    uint32_t *end = dst + count;
+    _mm256_storeu_si256((__m256i *)dst, v);
+
+    uint32_t *p = (uint32_t *)(((uintptr_t)dst + 32) & ~(uintptr_t)31);
+    for (; p + 32 <= end; p += 32)
+    {
+        _mm256_store_si256((__m256i *)(p + 0), v);
+        _mm256_store_si256((__m256i *)(p + 8), v);
+        _mm256_store_si256((__m256i *)(p + 16), v);
+        _mm256_store_si256((__m256i *)(p + 24), v);
+    }
+    for (; p + 8 <= end; p += 8)
+        _mm256_store_si256((__m256i *)p, v);
+
+    _mm256_storeu_si256((__m256i *)(end - 8), v);
+}
+
+__attribute__((target("avx512f"))) void olivec_fill_span_avx512(uint32_t *dst, size_t count, uint32_t color)
+{
+    // Masked stores are slow to retire and 512-bit stores split cache lines, so short spans take the narrower path
+    if (count < 32)
+    {
+        olivec_fill_span_avx2(dst, count, color);
+        return;
+    }
+
+    __m512i v = _mm512_set1_epi32((int)color);
+
+    uint32_t *end = dst + count;
+    _mm512_storeu_si512((void *)dst, v);
+
+    uint32_t *p = (uint32_t *)(((uintptr_t)dst + 64) & ~(uintptr_t)63);
+    for (; p + 64 <= end; p += 64)
+    {
+        _mm512_store_si512((void *)(p + 0), v);
+        _mm512_store_si512((void *)(p + 16), v);
+        _mm512_store_si512((void *)(p + 32), v);
+        _mm512_store_si512((void *)(p + 48), v);
+    }
+    for (; p + 16 <= end; p += 16)
+        _mm512_store_si512((void *)p, v);
+
+    _mm512_storeu_si512((void *)(end - 16), v);
+}
+
+// Non-temporal variants of the kernels above, only used for spans far longer than a vector. They bypass the cache, so clearing a canvas that does not fit into the
+// last level cache neither evicts everything else nor pays for reading the destination lines first.
+// The stores are weakly ordered: call olivec_stream_fence() after the last one.
+
+__attribute__((target("sse2"))) void olivec_stream_span_sse2(uint32_t *dst, size_t count, uint32_t color)
+{
+    size_t i = 0;
+    while (i < count && ((uintptr_t)(dst + i) & 15) != 0)
+        dst[i++] = color;
+
+    __m128i v = _mm_set1_epi32((int)color);
+    for (; i + 4 <= count; i += 4)
+        _mm_stream_si128((__m128i *)(dst + i), v);
+
+    for (; i < count; ++i)
+        dst[i] = color;
+}
+
+__attribute__((target("avx2"))) void olivec_stream_span_avx2(uint32_t *dst, size_t count, uint32_t color)
+{
+    size_t i = 0;
+    while (i < count && ((uintptr_t)(dst + i) & 31) != 0)
+        dst[i++] = color;
+
+    __m256i v = _mm256_set1_epi32((int)color);
+    for (; i + 8 <= count; i += 8)
+        _mm256_stream_si256((__m256i *)(dst + i), v);
+
+    for (; i < count; ++i)
+        dst[i] = color;
+}
+
+__attribute__((target("avx512f"))) void olivec_stream_span_avx512(uint32_t *dst, size_t count, uint32_t color)
+{
+    size_t i = 0;
+    while (i < count && ((uintptr_t)(dst + i) & 63) != 0)
+        dst[i++] = color;
+
+    __m512i v = _mm512_set1_epi32((int)color);
+    for (; i + 16 <= count; i += 16)
+        _mm512_stream_si512((void *)(dst + i), v);
+
+    for (; i < count; ++i)
+        dst[i] = color;
+}
+#endif // OLIVEC_X86
+
+void olivec_fill_span_resolve(uint32_t *dst, size_t count, uint32_t color);
+void olivec_stream_span_resolve(uint32_t *dst, size_t count, uint32_t color);
+
+// Fills `count` consecutive pixels starting at `dst`. Bound to the widest kernel the CPU supports on first use.
+void (*olivec_fill_span)(uint32_t *dst, size_t count, uint32_t color) = olivec_fill_span_resolve;
+
+// Same as olivec_fill_span but with non-temporal stores when the CPU has them
+void (*olivec_stream_span)(uint32_t *dst, size_t count, uint32_t color) = olivec_stream_span_resolve;
+
+Olivec_Simd olivec_simd_current = OLIVEC_SIMD_SCALAR;
+
+#ifndef OLIVEC_STREAM_THRESHOLD
+#define OLIVEC_STREAM_THRESHOLD (16 * 1024 * 1024)
+#endif
+
+// Fills that write at least this many bytes use non-temporal stores. Tune it per host with `./bin/bench fill`.
+size_t olivec_stream_threshold = OLIVEC_STREAM_THRESHOLD;
+
+void olivec_stream_fence(void)
+{
+#ifdef OLIVEC_X86
+    _mm_sfence();
+#endif
+}
+
+// Asks CPUID (through the compiler's cpu model) which vector extensions the CPU and the OS actually support
+Olivec_Simd olivec_simd_detect(void)
+{
+#ifdef OLIVEC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return OLIVEC_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return OLIVEC_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return OLIVEC_SIMD_SSE2;
+#endif
+    return OLIVEC_SIMD_SCALAR;
+}
+
+const char *olivec_simd_name(Olivec_Simd simd)
+{
+    switch (simd)
+    {
+    case OLIVEC_SIMD_SCALAR:
+        return "scalar";
+    case OLIVEC_SIMD_SSE2:
+        return "sse2";
+    case OLIVEC_SIMD_AVX2:
+        return "avx2";
+    case OLIVEC_SIMD_AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+// Binds the kernels to `simd`, or to the best level below it when the CPU lacks `simd`. Returns the level in use.
+Olivec_Simd olivec_simd_use(Olivec_Simd simd)
+{
+    Olivec_Simd detected = olivec_simd_detect();
+    if (simd > detected)
+        simd = detected;
+
+    olivec_fill_span = olivec_fill_span_scalar;
+    olivec_stream_span = olivec_fill_span_scalar;
+#ifdef OLIVEC_X86
+    switch (simd)
+    {
+    case OLIVEC_SIMD_SCALAR:
+        break;
+    case OLIVEC_SIMD_SSE2:
+        olivec_fill_span = olivec_fill_span_sse2;
+        olivec_stream_span = olivec_stream_span_sse2;
+        break;
+    case OLIVEC_SIMD_AVX2:
+        olivec_fill_span = olivec_fill_span_avx2;
+        olivec_stream_span = olivec_stream_span_avx2;
+        break;
+    case OLIVEC_SIMD_AVX512:
+        olivec_fill_span = olivec_fill_span_avx512;
+        olivec_stream_span = olivec_stream_span_avx512;
+        break;
+    }
+#endif
+    olivec_simd_current = simd;
+    return simd;
+}
+
+void olivec_fill_span_resolve(uint32_t *dst, size_t count, uint32_t color)
+{
+    olivec_simd_use(olivec_simd_detect());
+    olivec_fill_span(dst, count, color);
+}
+
+void olivec_stream_span_resolve(uint32_t *dst, size_t count, uint32_t color)
+{
+    olivec_simd_use(olivec_simd_detect());
+    olivec_stream_span(dst, count, color);
+}
+
+typedef struct
+{
+    uint32_t *pixels;
+    size_t width;
+    size_t height;
+    // Distance in pixels between the starts of two consecutive rows. Equal to width for packed buffers and
+    // larger for padded framebuffers or for views into a bigger canvas.
+    size_t stride;
+} Olivec_Canvas;
+
+#define OLIVEC_CANVAS_NULL ((Olivec_Canvas){0})
+// Row offsets are computed in size_t, so canvases past 2^31 pixels are addressed correctly
+#define OLIVEC_PIXEL(oc, x, y) (oc).pixels[(size_t)(y) * (oc).stride + (size_t)(x)]
+
+Olivec_Canvas olivec_canvas(uint32_t *pixels, size_t width, size_t height, size_t stride)
+{
+    Olivec_Canvas oc = {
+        .pixels = pixels,
+        .width = width,
+        .height = height,
+        .stride = stride,
+    };
+    return oc;
+}
+
+#ifndef OLIVEC_MAX_THREADS
+#define OLIVEC_MAX_THREADS 64
+#endif
+
+#ifndef OLIVEC_PARALLEL_THRESHOLD
+#define OLIVEC_PARALLEL_THRESHOLD (512 * 1024)
+#endif
+
+// Work smaller than this many pixels always runs on the calling thread, where waking the workers would cost more
+// than it saves
+size_t olivec_parallel_threshold = OLIVEC_PARALLEL_THRESHOLD;
+
+// Processes the items [begin, end) of a job that olivec_parallel_for() split across the threads
+typedef void (*Olivec_Job)(void *ctx, size_t begin, size_t end);
+
+#ifdef OLIVEC_THREADS
+typedef struct
+{
+    pthread_t threads[OLIVEC_MAX_THREADS];
+    size_t count;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    // Bumped for every job so that sleeping workers can tell a new job from a spurious wake up
+    size_t generation;
+    size_t started_at;
+    size_t pending;
+    bool busy;
+    bool quit;
+
+    Olivec_Job job;
+    void *ctx;
+    size_t items;
+} Olivec_Thread_Pool;
+
+Olivec_Thread_Pool olivec_pool = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+};
+
+// The calling thread always takes part 0, worker `index` takes part `index + 1`
+void olivec_run_part(Olivec_Job job, void *ctx, size_t items, size_t part, size_t parts)
+{
+    size_t begin = items * part / parts;
+    size_t end = items * (part + 1) / parts;
+    if (begin < end)
+        job(ctx, begin, end);
+}
+
+void *olivec_thread_worker(void *arg)
+{
+    size_t index = (size_t)(uintptr_t)arg;
+
+    pthread_mutex_lock(&olivec_pool.mutex);
+    size_t seen = olivec_pool.started_at;
+    for (;;)
+    {
+        while (!olivec_pool.quit && olivec_pool.generation == seen)
+            pthread_cond_wait(&olivec_pool.work_cond, &olivec_pool.mutex);
+        if (olivec_pool.quit)
+            break;
+        seen = olivec_pool.generation;
+
+        Olivec_Job job = olivec_pool.job;
+        void *ctx = olivec_pool.ctx;
+        size_t items = olivec_pool.items;
+        size_t parts = olivec_pool.count + 1;
+        pthread_mutex_unlock(&olivec_pool.mutex);
+
+        olivec_run_part(job, ctx, items, index + 1, parts);
+
+        pthread_mutex_lock(&olivec_pool.mutex);
+        olivec_pool.pending -= 1;
+        if (olivec_pool.pending == 0)
+            pthread_cond_signal(&olivec_pool.done_cond);
+    }
+    pthread_mutex_unlock(&olivec_pool.mutex);
+    return NULL;
+}
+#endif // OLIVEC_THREADS
+
+void olivec_threads_stop(void);
+
+// Starts `count` worker threads that big fills are split across, in addition to the calling thread.
+// Returns false when the platform has no threads or they could not be created; everything then stays serial.
+bool olivec_threads_start(size_t count)
+{
+#ifdef OLIVEC_THREADS
+    olivec_threads_stop();
+    if (count > OLIVEC_MAX_THREADS)
+        count = OLIVEC_MAX_THREADS;
+
+    olivec_pool.quit = false;
+    olivec_pool.started_at = olivec_pool.generation;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (pthread_create(&olivec_pool.threads[i], NULL, olivec_thread_worker, (void *)(uintptr_t)i) != 0)
+        {
+            olivec_threads_stop();
+            return false;
+        }
+        olivec_pool.count = i + 1;
+    }
+    return count > 0;
+#else
+    (void)count;
+    return false;
+#endif
+}
+
+void olivec_threads_stop(void)
+{
+#ifdef OLIVEC_THREADS
+    pthread_mutex_lock(&olivec_pool.mutex);
+    olivec_pool.quit = true;
+    pthread_cond_broadcast(&olivec_pool.work_cond);
+    pthread_mutex_unlock(&olivec_pool.mutex);
+
+    for (size_t i = 0; i < olivec_pool.count; ++i)
+        pthread_join(olivec_pool.threads[i], NULL);
+    olivec_pool.count = 0;
+#endif
+}
+
+// Splits `items` into one contiguous part per thread and runs `job` on all of them, returning once every part is
+// done. `cost` is the number of pixels the whole job touches and is compared against olivec_parallel_threshold.
+void olivec_parallel_for(size_t items, size_t cost, Olivec_Job job, void *ctx)
+{
+#ifdef OLIVEC_THREADS
+    if (olivec_pool.count > 0 && items > 1 && cost >= olivec_parallel_threshold)
+    {
+        pthread_mutex_lock(&olivec_pool.mutex);
+        // Jobs started from inside a job run serially instead of waiting for workers that are busy with the outer one
+        if (!olivec_pool.busy)
+        {
+            olivec_pool.busy = true;
+            olivec_pool.job = job;
+            olivec_pool.ctx = ctx;
+            olivec_pool.items = items;
+            olivec_pool.pending = olivec_pool.count;
+            olivec_pool.generation += 1;
+            pthread_cond_broadcast(&olivec_pool.work_cond);
+            pthread_mutex_unlock(&olivec_pool.mutex);
+
+            olivec_run_part(job, ctx, items, 0, olivec_pool.count + 1);
+
+            pthread_mutex_lock(&olivec_pool.mutex);
+            while (olivec_pool.pending > 0)
+                pthread_cond_wait(&olivec_pool.done_cond, &olivec_pool.mutex);
+            olivec_pool.busy = false;
+            pthread_mutex_unlock(&olivec_pool.mutex);
+            return;
+        }
+        pthread_mutex_unlock(&olivec_pool.mutex);
+    }
+#else
+    (void)cost;
+#endif
+    job(ctx, 0, items);
+}
+
+typedef struct
+{
+    Olivec_Canvas oc;
+    int x;
+    int y;
+    size_t span;
+    uint32_t color;
+    bool stream;
+} Olivec_Fill_Rows;
+
+void olivec_fill_rows_job(void *ctx, size_t begin, size_t end)
+{
+    Olivec_Fill_Rows *fr = ctx;
+    Olivec_Canvas oc = fr->oc;
+    void (*fill_span)(uint32_t *, size_t, uint32_t) = fr->stream ? olivec_stream_span : olivec_fill_span;
+
+    if (fr->span == oc.stride)
+    {
+        // Full-width rows of a packed canvas are contiguous, so the whole band is a single span
+        fill_span(&OLIVEC_PIXEL(oc, 0, fr->y + begin), fr->span * (end - begin), fr->color);
+    }
+    else
+    {
+        for (size_t row = begin; row < end; ++row)
+        {
+            fill_span(&OLIVEC_PIXEL(oc, fr->x, fr->y + row), fr->span, fr->color);
+        }
+    }
+
+    // Non-temporal stores are only ordered on the thread that issued them
+    if (fr->stream)
+        olivec_stream_fence();
+}
+
+// Fills `rows` rows of `span` pixels starting at (x, y), which must already be clipped to the canvas.
+// Large fills use streaming stores and are split into horizontal bands across the thread pool; every band writes
+// its own rows, so the result does not depend on the number of threads.
+void olivec_fill_rows(Olivec_Canvas oc, int x, int y, size_t span, size_t rows, uint32_t color)
+{
+    Olivec_Fill_Rows fr = {
+        .oc = oc,
+        .x = x,
+        .y = y,
+        .span = span,
+        .color = color,
+        .stream = span * rows * sizeof(uint32_t) >= olivec_stream_threshold,
+    };
+    olivec_parallel_for(rows, span * rows, olivec_fill_rows_job, &fr);
+}
+
+typedef struct
+{
+    // Inclusive bounds, always ordered so that x1 <= x2 and y1 <= y2
+    int x1, x2;
+    int y1, y2;
+} Olivec_Normalized_Rect;
+
+// Turns a rectangle whose width and height may be negative into ordered bounds and intersects it with the canvas.
+// Returns false when nothing of the rectangle is visible, so callers can bail out before touching a single row.
+bool olivec_normalize_rect(int x, int y, int w, int h, size_t canvas_width, size_t canvas_height, Olivec_Normalized_Rect *nr)
+{
+    if (w == 0 || h == 0)
+        return false;
+
+    nr->x1 = x;
+    nr->x2 = x + OLIVEC_SIGN(int, w) * (OLIVEC_ABS(int, w) - 1);
+    if (nr->x1 > nr->x2)
+        OLIVEC_SWAP(int, nr->x1, nr->x2);
+
+    nr->y1 = y;
+    nr->y2 = y + OLIVEC_SIGN(int, h) * (OLIVEC_ABS(int, h) - 1);
+    if (nr->y1 > nr->y2)
+        OLIVEC_SWAP(int, nr->y1, nr->y2);
+
+    if (nr->x2 < 0 || nr->x1 >= (int)canvas_width)
+        return false;
+    if (nr->y2 < 0 || nr->y1 >= (int)canvas_height)
+        return false;
+
+    if (nr->x1 < 0)
+        nr->x1 = 0;
+    if (nr->x2 >= (int)canvas_width)
+        nr->x2 = (int)canvas_width - 1;
+    if (nr->y1 < 0)
+        nr->y1 = 0;
+    if (nr->y2 >= (int)canvas_height)
+        nr->y2 = (int)canvas_height - 1;
+
+    return true;
+}
+
+typedef enum
+{
+    OLIVEC_OUTSIDE = 0,
+    OLIVEC_STRADDLE,
+    OLIVEC_INSIDE,
+} Olivec_Clip;
+
+// Classifies the inclusive bounds of a primitive against the canvas before it is rasterized: OLIVEC_OUTSIDE draws
+// nothing, OLIVEC_INSIDE can skip every clip check, and only OLIVEC_STRADDLE needs the clipped kernel.
+Olivec_Clip olivec_clip_size(size_t width, size_t height, int64_t x1, int64_t y1, int64_t x2, int64_t y2)
+{
+    if (x2 < 0 || y2 < 0 || x1 >= (int64_t)width || y1 >= (int64_t)height)
+        return OLIVEC_OUTSIDE;
+    if (x1 >= 0 && y1 >= 0 && x2 < (int64_t)width && y2 < (int64_t)height)
+        return OLIVEC_INSIDE;
+    return OLIVEC_STRADDLE;
+}
+
+Olivec_Clip olivec_clip_bounds(Olivec_Canvas oc, int64_t x1, int64_t y1, int64_t x2, int64_t y2)
+{
+    return olivec_clip_size(oc.width, oc.height, x1, y1, x2, y2);
+}
+
+// Maps `file_path` into memory as a packed width x height canvas, creating the file or resizing it as needed.
+// Pages are only read from or written back to the file as they are touched, so the canvas can be far larger than RAM.
+// Returns OLIVEC_CANVAS_NULL with errno set on failure.
+Olivec_Canvas olivec_canvas_mmap(const char *file_path, size_t width, size_t height)
+{
+#ifdef OLIVEC_POSIX
+    size_t size = width * height * sizeof(uint32_t);
+    if (size == 0 || size / sizeof(uint32_t) / width != height)
+        return OLIVEC_CANVAS_NULL;
+
+    int fd = open(file_path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return OLIVEC_CANVAS_NULL;
+
+    // Growing the file with ftruncate keeps it sparse, the disk is only used for the pages that get drawn to
+    if (ftruncate(fd, (off_t)size) < 0)
+    {
+        close(fd);
+        return OLIVEC_CANVAS_NULL;
+    }
+
+    void *pixels = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive on its own
+    close(fd);
+    if (pixels == MAP_FAILED)
+        return OLIVEC_CANVAS_NULL;
+
+    return olivec_canvas(pixels, width, height, width);
+#else
+    (void)file_path;
+    (void)width;
+    (void)height;
+    return OLIVEC_CANVAS_NULL;
+#endif
+}
+
+// Writes the pixels of a canvas returned by olivec_canvas_mmap() back to its file and unmaps it.
+// Must be given the canvas itself, not a view of it.
+void olivec_canvas_munmap(Olivec_Canvas oc)
+{
+#ifdef OLIVEC_POSIX
+    if (oc.pixels == NULL)
+        return;
+    size_t size = oc.height * oc.stride * sizeof(uint32_t);
+    msync(oc.pixels, size, MS_SYNC);
+    munmap(oc.pixels, size);
+#else
+    (void)oc;
+#endif
+}
+
+#ifndef OLIVEC_CANVAS_ALIGNMENT
+#define OLIVEC_CANVAS_ALIGNMENT 64
+#endif
+
+#ifndef OLIVEC_HUGE_PAGE_SIZE
+#define OLIVEC_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+// Canvases of at least one huge page are mapped directly, aligned to the huge page size, and handed to the
+// kernel as transparent huge page candidates. One TLB entry then covers 512 times more pixels.
+#if defined(OLIVEC_POSIX) && defined(MAP_ANONYMOUS)
+#define OLIVEC_HUGE_PAGES
+#endif
+
+size_t olivec_canvas_alloc_size(Olivec_Canvas oc)
+{
+    size_t size = oc.height * oc.stride * sizeof(uint32_t);
+#ifdef OLIVEC_HUGE_PAGES
+    if (size >= OLIVEC_HUGE_PAGE_SIZE)
+        size = (size + OLIVEC_HUGE_PAGE_SIZE - 1) / OLIVEC_HUGE_PAGE_SIZE * OLIVEC_HUGE_PAGE_SIZE;
+#endif
+    return size;
+}
+
+// Allocates a width x height canvas whose pixels start on an OLIVEC_CANVAS_ALIGNMENT boundary and whose rows are
+// padded so that every row starts on a `row_alignment` byte boundary (a multiple of 4, 0 means
+// OLIVEC_CANVAS_ALIGNMENT). With the default every row begins on its own cache line and vector kernels never
+// split a store across two lines. Returns OLIVEC_CANVAS_NULL when out of memory. Free with olivec_canvas_free().
+Olivec_Canvas olivec_canvas_alloc(size_t width, size_t height, size_t row_alignment)
+{
+#ifndef OLIVEC_FREESTANDING
+    if (row_alignment == 0)
+        row_alignment = OLIVEC_CANVAS_ALIGNMENT;
+    size_t row_pixels = row_alignment / sizeof(uint32_t);
+    if (width == 0 || height == 0 || row_pixels == 0)
+        return OLIVEC_CANVAS_NULL;
+
+    size_t stride = (width + row_pixels - 1) / row_pixels * row_pixels;
+    // Rows can only be aligned to more than the pixels themselves are
+    size_t alignment = OLIVEC_CANVAS_ALIGNMENT;
+    if (row_alignment > alignment && (row_alignment & (row_alignment - 1)) == 0)
+        alignment = row_alignment;
+    Olivec_Canvas oc = olivec_canvas(NULL, width, height, stride);
+    size_t size = olivec_canvas_alloc_size(oc);
+
+#ifdef OLIVEC_HUGE_PAGES
+    if (size >= OLIVEC_HUGE_PAGE_SIZE)
+    {
+        // Map one huge page more than needed and trim it, which leaves a mapping aligned to the huge page size
+        size_t mapped = size + OLIVEC_HUGE_PAGE_SIZE;
+        uint8_t *base = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+            return OLIVEC_CANVAS_NULL;
+
+        uint8_t *aligned = (uint8_t *)(((uintptr_t)base + OLIVEC_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(OLIVEC_HUGE_PAGE_SIZE - 1));
+        if (aligned > base)
+            munmap(base, (size_t)(aligned - base));
+        if (base + mapped > aligned + size)
+            munmap(aligned + size, (size_t)(base + mapped - (aligned + size)));
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        oc.pixels = (uint32_t *)aligned;
+        return oc;
+    }
+#endif
+
+#ifdef OLIVEC_POSIX
+    void *pixels = NULL;
+    if (posix_memalign(&pixels, alignment, size) != 0)
+        return OLIVEC_CANVAS_NULL;
+    oc.pixels = pixels;
+#else
+    // No aligned allocator in C99, so over-allocate and keep the original pointer right before the pixels
+    uint8_t *base = malloc(size + alignment + sizeof(void *));
+    if (base == NULL)
+        return OLIVEC_CANVAS_NULL;
+    uintptr_t aligned = ((uintptr_t)(base + sizeof(void *)) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    ((void **)aligned)[-1] = base;
+    oc.pixels = (uint32_t *)aligned;
+#endif
+    return oc;
+#else
+    (void)width;
+    (void)height;
+    (void)row_alignment;
+    return OLIVEC_CANVAS_NULL;
+#endif
+}
+
+// Frees a canvas returned by olivec_canvas_alloc(). Must be given the canvas itself, not a view of it.
+void olivec_canvas_free(Olivec_Canvas oc)
+{
+#ifndef OLIVEC_FREESTANDING
+    if (oc.pixels == NULL)
+        return;
+
+    size_t size = olivec_canvas_alloc_size(oc);
+#ifdef OLIVEC_HUGE_PAGES
+    if (size >= OLIVEC_HUGE_PAGE_SIZE)
+    {
+        munmap(oc.pixels, size);
+        return;
+    }
+#else
+    (void)size;
+#endif
+
+#ifdef OLIVEC_POSIX
+    free(oc.pixels);
+#else
+    free(((void **)oc.pixels)[-1]);
+#endif
+#else
+    (void)oc;
+#endif
+}
+
+// A view into the (x, y, w, h) region of `oc` that shares its pixels. Coordinates inside the view are relative to
+// its top-left corner and every primitive clips against it. Returns OLIVEC_CANVAS_NULL when the region is off `oc`.
+Olivec_Canvas olivec_subcanvas(Olivec_Canvas oc, int x, int y, int w, int h)
+{
+    Olivec_Normalized_Rect nr;
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr))
+        return OLIVEC_CANVAS_NULL;
+
+    oc.pixels = &OLIVEC_PIXEL(oc, nr.x1, nr.y1);
+    oc.width = (size_t)(nr.x2 - nr.x1 + 1);
+    oc.height = (size_t)(nr.y2 - nr.y1 + 1);
+    return oc;
+}
+
+typedef struct
+{
+    int x, y;
+    int w, h;
+} Olivec_Rect;
+
+#ifndef OLIVEC_DAMAGE_CAPACITY
+#define OLIVEC_DAMAGE_CAPACITY 32
+#endif
+
+typedef struct
+{
+    // The canvas whose damage is tracked. Primitives drawn into views of it are tracked too.
+    Olivec_Canvas canvas;
+    // Damage of the frame being drawn
+    Olivec_Rect rects[OLIVEC_DAMAGE_CAPACITY];
+    size_t count;
+    // Damage of the previous frame, erased by the next olivec_damage_begin()
+    Olivec_Rect prev[OLIVEC_DAMAGE_CAPACITY];
+    size_t prev_count;
+    // Everything that changed since the previous frame was presented: the union of both frames' damage.
+    // Filled in by olivec_damage_end(); this is what a presenter has to upload.
+    Olivec_Rect present[OLIVEC_DAMAGE_CAPACITY];
+    size_t present_count;
+} Olivec_Damage;
+
+// The tracker that primitives currently report their clipped bounding boxes to, if any
+Olivec_Damage *olivec_damage = NULL;
+
+size_t olivec_rect_area(Olivec_Rect r)
+{
+    return (size_t)r.w * (size_t)r.h;
+}
+
+Olivec_Rect olivec_rect_union(Olivec_Rect a, Olivec_Rect b)
+{
+    int x1 = a.x < b.x ? a.x : b.x;
+    int y1 = a.y < b.y ? a.y : b.y;
+    int x2 = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+    int y2 = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+    return (Olivec_Rect){x1, y1, x2 - x1, y2 - y1};
+}
+
+// Overlapping or sharing an edge
+bool olivec_rects_touch(Olivec_Rect a, Olivec_Rect b)
+{
+    return a.x <= b.x + b.w && b.x <= a.x + a.w && a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+// Adds `r` to the list, merging it with every rect it touches. When the list is full, `r` is merged into the rect
+// whose area grows the least, so the list always covers everything that was added to it.
+void olivec_rect_list_add(Olivec_Rect *rects, size_t *count, size_t capacity, Olivec_Rect r)
+{
+    for (size_t i = 0; i < *count;)
+    {
+        if (olivec_rects_touch(rects[i], r))
+        {
+            r = olivec_rect_union(rects[i], r);
+            rects[i] = rects[--*count];
+            // The grown rect may touch rects that were already checked
+            i = 0;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    if (*count >= capacity)
+    {
+        size_t best = 0;
+        size_t best_growth = SIZE_MAX;
+        for (size_t i = 0; i < *count; ++i)
+        {
+            size_t growth = olivec_rect_area(olivec_rect_union(rects[i], r)) - olivec_rect_area(rects[i]);
+            if (growth < best_growth)
+            {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        r = olivec_rect_union(rects[best], r);
+        rects[best] = rects[--*count];
+        olivec_rect_list_add(rects, count, capacity, r);
+        return;
+    }
+
+    rects[(*count)++] = r;
+}
+
+// Reports that the primitive being drawn into `oc` touched `nr`, which must be clipped to `oc`
+void olivec_damage_rect(Olivec_Canvas oc, Olivec_Normalized_Rect nr)
+{
+    Olivec_Damage *d = olivec_damage;
+    if (d == NULL)
+        return;
+
+    // Views share the pixels of the tracked canvas, so their offset in it follows from the pixel address
+    Olivec_Canvas root = d->canvas;
+    if (oc.stride != root.stride || oc.pixels < root.pixels || oc.pixels >= root.pixels + root.height * root.stride)
+        return;
+    size_t offset = (size_t)(oc.pixels - root.pixels);
+    int ox = (int)(offset % root.stride);
+    int oy = (int)(offset / root.stride);
+
+    Olivec_Rect r = {nr.x1 + ox, nr.y1 + oy, nr.x2 - nr.x1 + 1, nr.y2 - nr.y1 + 1};
+    olivec_rect_list_add(d->rects, &d->count, OLIVEC_DAMAGE_CAPACITY, r);
+}
+
+// Same as olivec_damage_rect() for an unclipped bounding box with inclusive corners in any order
+void olivec_damage_bounds(Olivec_Canvas oc, int64_t x1, int64_t y1, int64_t x2, int64_t y2)
+{
+    if (olivec_damage == NULL)
+        return;
+
+    // Clipped in int64_t, the bounds of a primitive can be further apart than an int can count
+    int64_t left = x1 < x2 ? x1 : x2;
+    int64_t right = x1 > x2 ? x1 : x2;
+    int64_t top = y1 < y2 ? y1 : y2;
+    int64_t bottom = y1 > y2 ? y1 : y2;
+    left = left > 0 ? left : 0;
+    top = top > 0 ? top : 0;
+    right = right < (int64_t)oc.width - 1 ? right : (int64_t)oc.width - 1;
+    bottom = bottom < (int64_t)oc.height - 1 ? bottom : (int64_t)oc.height - 1;
+    if (left > right || top > bottom)
+        return;
+    olivec_damage_rect(oc, (Olivec_Normalized_Rect){(int)left, (int)right, (int)top, (int)bottom});
+}
+
+void olivec_fill(Olivec_Canvas oc, uint32_t color)
+{
+    if (oc.width == 0 || oc.height == 0)
+        return;
+
+    olivec_damage_rect(oc, (Olivec_Normalized_Rect){0, (int)oc.width - 1, 0, (int)oc.height - 1});
+    olivec_fill_rows(oc, 0, 0, oc.width, oc.height, color);
+}
+
+void olivec_fill_rect(Olivec_Canvas oc, int x, int y, int w, int h, uint32_t color)
+{
+    Olivec_Normalized_Rect nr;
+    if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr))
+        return;
+
+    olivec_damage_rect(oc, nr);
+
+    olivec_fill_rows(oc, nr.x1, nr.y1, (size_t)(nr.x2 - nr.x1 + 1), (size_t)(nr.y2 - nr.y1 + 1), color);
+}
+
+// The batch lives on the stack (about 22 bytes per rect), so keep it small where the stack is only 64 KiB
+#ifndef OLIVEC_RECTS_BATCH
+#ifdef OLIVEC_FREESTANDING
+#define OLIVEC_RECTS_BATCH 512
+#else
+#define OLIVEC_RECTS_BATCH 4096
+#endif
+#endif
+
+// Batched fills sweep the canvas in bands of this many rows, small enough for a band of a 4K canvas to stay in L2
+#ifndef OLIVEC_BAND_HEIGHT
+#define OLIVEC_BAND_HEIGHT 8
+#endif
+
+typedef struct
+{
+    Olivec_Canvas oc;
+    Olivec_Normalized_Rect rects[OLIVEC_RECTS_BATCH];
+    uint32_t colors[OLIVEC_RECTS_BATCH];
+    // Indices into `rects` sorted by their first row
+    uint16_t order[OLIVEC_RECTS_BATCH];
+    size_t count;
+    // First row of the first band
+    int y;
+} Olivec_Rects_Batch;
+
+// Stable bottom-up merge sort of the indices in `order` by the first row of the rect they point to. Rects that
+// start on the same row keep their original order.
+void olivec_sort_rects_by_row(const Olivec_Normalized_Rect *rects, uint16_t *order, size_t count)
+{
+    uint16_t scratch[OLIVEC_RECTS_BATCH];
+    uint16_t *src = order;
+    uint16_t *dst = scratch;
+
+    for (size_t width = 1; width < count; width *= 2)
+    {
+        for (size_t begin = 0; begin < count; begin += 2 * width)
+        {
+            size_t mid = begin + width < count ? begin + width : count;
+            size_t end = begin + 2 * width < count ? begin + 2 * width : count;
+            size_t i = begin, j = mid, k = begin;
+            while (i < mid && j < end)
+                dst[k++] = rects[src[j]].y1 < rects[src[i]].y1 ? src[j++] : src[i++];
+            while (i < mid)
+                dst[k++] = src[i++];
+            while (j < end)
+                dst[k++] = src[j++];
+        }
+        OLIVEC_SWAP(uint16_t *, src, dst);
+    }
+
+    if (src != order)
+    {
+        for (size_t i = 0; i < count; ++i)
+            order[i] = src[i];
+    }
+}
+
+// Fills the bands [begin, end) of a batch. Every band only visits the rects that overlap it, and visits them in the
+// order they were given in, so overlapping rects paint over each other exactly like individual calls would.
+void olivec_fill_rects_job(void *ctx, size_t begin, size_t end)
+{
+    Olivec_Rects_Batch *batch = ctx;
+    uint16_t active[OLIVEC_RECTS_BATCH];
+    size_t active_count = 0;
+    size_t next = 0;
+
+    int last_row = batch->y + (int)end * OLIVEC_BAND_HEIGHT - 1;
+    for (int band_y1 = batch->y + (int)begin * OLIVEC_BAND_HEIGHT; band_y1 <= last_row; band_y1 += OLIVEC_BAND_HEIGHT)
+    {
+        // Nothing to draw until the next rect starts, so skip straight to its band
+        if (active_count == 0)
+        {
+            if (next >= batch->count)
+                break;
+            int y1 = batch->rects[batch->order[next]].y1;
+            if (y1 > band_y1)
+                band_y1 += (y1 - band_y1) / OLIVEC_BAND_HEIGHT * OLIVEC_BAND_HEIGHT;
+            if (band_y1 > last_row)
+                break;
+        }
+        int band_y2 = band_y1 + OLIVEC_BAND_HEIGHT - 1;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < active_count; ++i)
+        {
+            if (batch->rects[active[i]].y2 >= band_y1)
+                active[kept++] = active[i];
+        }
+        active_count = kept;
+
+        // A worker's first band also picks up the rects that started in bands before its own
+        while (next < batch->count && batch->rects[batch->order[next]].y1 <= band_y2)
+        {
+            uint16_t index = batch->order[next++];
+            if (batch->rects[index].y2 < band_y1)
+                continue;
+
+            size_t j = active_count++;
+            while (j > 0 && active[j - 1] > index)
+            {
+                active[j] = active[j - 1];
+                --j;
+            }
+            active[j] = index;
+        }
+
+        for (size_t i = 0; i < active_count; ++i)
+        {
+            Olivec_Normalized_Rect nr = batch->rects[active[i]];
+            int y1 = nr.y1 > band_y1 ? nr.y1 : band_y1;
+            int y2 = nr.y2 < band_y2 ? nr.y2 : band_y2;
+            for (int y = y1; y <= y2; ++y)
+            {
+                olivec_fill_span(&OLIVEC_PIXEL(batch->oc, nr.x1, y), (size_t)(nr.x2 - nr.x1 + 1), batch->colors[active[i]]);
+            }
+        }
+    }
+}
+
+// Fills `count` rects, rects[i] with colors[i], with the same result as calling olivec_fill_rect() on each in order.
+// The rects are clipped up front, sorted by row and drawn band by band, so each band of the canvas is brought
+// into the cache once instead of once per rect. Big batches are split by band across the thread pool.
+void olivec_fill_rects(Olivec_Canvas oc, const Olivec_Rect *rects, const uint32_t *colors, size_t count)
+{
+    _Static_assert(OLIVEC_RECTS_BATCH <= UINT16_MAX + 1, "rect indices must fit into uint16_t");
+
+    while (count > 0)
+    {
+        Olivec_Rects_Batch batch;
+        batch.oc = oc;
+        batch.count = 0;
+
+        size_t area = 0;
+        Olivec_Normalized_Rect bounds = {0};
+        size_t taken = 0;
+        for (; taken < count && batch.count < OLIVEC_RECTS_BATCH; ++taken)
+        {
+            Olivec_Rect r = rects[taken];
+            Olivec_Normalized_Rect nr;
+            if (!olivec_normalize_rect(r.x, r.y, r.w, r.h, oc.width, oc.height, &nr))
+                continue;
+
+            if (batch.count == 0)
+            {
+                bounds = nr;
+            }
+            else
+            {
+                if (nr.x1 < bounds.x1)
+                    bounds.x1 = nr.x1;
+                if (nr.x2 > bounds.x2)
+                    bounds.x2 = nr.x2;
+                if (nr.y1 < bounds.y1)
+                    bounds.y1 = nr.y1;
+                if (nr.y2 > bounds.y2)
+                    bounds.y2 = nr.y2;
+            }
+            area += (size_t)(nr.x2 - nr.x1 + 1) * (size_t)(nr.y2 - nr.y1 + 1);
+
+            batch.order[batch.count] = (uint16_t)batch.count;
+            batch.rects[batch.count] = nr;
+            batch.colors[batch.count] = colors[taken];
+            batch.count += 1;
+        }
+        rects += taken;
+        colors += taken;
+        count -= taken;
+
+        if (batch.count == 0)
+            continue;
+
+        olivec_sort_rects_by_row(batch.rects, batch.order, batch.count);
+        olivec_damage_rect(oc, bounds);
+        batch.y = bounds.y1;
+        size_t bands = (size_t)((bounds.y2 - bounds.y1) / OLIVEC_BAND_HEIGHT + 1);
+        olivec_parallel_for(bands, area, olivec_fill_rects_job, &batch);
+    }
+}
+
+// Starts tracking a frame drawn into `oc`. Erases only what the previous frame drew, to `background`.
+// The first frame on a canvas, or after the canvas changed, clears all of it.
+void olivec_damage_begin(Olivec_Damage *d, Olivec_Canvas oc, uint32_t background)
+{
+    olivec_damage = NULL;
+
+    if (d->canvas.pixels != oc.pixels || d->canvas.width != oc.width || d->canvas.height != oc.height || d->canvas.stride != oc.stride)
+    {
+        d->canvas = oc;
+        olivec_fill(oc, background);
+        d->prev[0] = (Olivec_Rect){0, 0, (int)oc.width, (int)oc.height};
+        d->prev_count = 1;
+    }
+    else
+    {
+        for (size_t i = 0; i < d->prev_count; ++i)
+        {
+            Olivec_Rect r = d->prev[i];
+            olivec_fill_rect(oc, r.x, r.y, r.w, r.h, background);
+        }
+    }
+
+    d->count = 0;
+    olivec_damage = d;
+}
+
+// Stops tracking and computes the regions the presenter has to upload in `d->present`
+void olivec_damage_end(Olivec_Damage *d)
+{
+    olivec_damage = NULL;
+
+    d->present_count = 0;
+    for (size_t i = 0; i < d->prev_count; ++i)
+        olivec_rect_list_add(d->present, &d->present_count, OLIVEC_DAMAGE_CAPACITY, d->prev[i]);
+    for (size_t i = 0; i < d->count; ++i)
+        olivec_rect_list_add(d->present, &d->present_count, OLIVEC_DAMAGE_CAPACITY, d->rects[i]);
+
+    for (size_t i = 0; i < d->count; ++i)
+        d->prev[i] = d->rects[i];
+    d->prev_count = d->count;
+}
+
+// Largest x such that x*x <= n. Bit by bit, so it needs neither libm nor floating point
+uint64_t olivec_isqrt(uint64_t n)
+{
+    if (n == 0)
+        return 0;
+
+    uint64_t x = 0;
+    // Start at the highest even power of two that is <= n
+#if defined(__GNUC__)
+    uint64_t bit = (uint64_t)1 << ((63 - __builtin_clzll(n)) & ~1);
+#else
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > n)
+        bit >>= 2;
+#endif
+    while (bit != 0)
+    {
+        if (n >= x + bit)
+        {
+            n -= x + bit;
+            x = (x >> 1) + bit;
+        }
+        else
+        {
+            x >>= 1;
+        }
+        bit >>= 2;
+    }
+    return x;
+}
+
+// Fills `count` pixels from `dst`, count > 0. The rows of small shapes are cheaper to write in place than through the
+// indirect call into the SIMD kernel. Their lengths change from row to row, so they are written with overlapping
+// stores instead of a loop whose exit the branch predictor would keep missing
+void olivec_fill_row_span(uint32_t *dst, size_t count, uint32_t color)
+{
+    if (count < 4)
+    {
+        dst[0] = color;
+        dst[count / 2] = color;
+        dst[count - 1] = color;
+        return;
+    }
+    if (count <= 8)
+    {
+        dst[0] = color;
+        dst[1] = color;
+        dst[2] = color;
+        dst[3] = color;
+        dst[count - 4] = color;
+        dst[count - 3] = color;
+        dst[count - 2] = color;
+        dst[count - 1] = color;
+        return;
+    }
+    olivec_fill_span(dst, count, color);
+}
+
+// Fills the pixels x1..x2 (inclusive) of the row y of a primitive whose bounds olivec_clip_bounds() classified,
+// clipping the row only when the primitive straddles the canvas. The row itself must be on the canvas
+void olivec_fill_row_clip(Olivec_Canvas oc, Olivec_Clip clip, int y, int64_t x1, int64_t x2, uint32_t color)
+{
+    if (clip != OLIVEC_INSIDE)
+    {
+        if (x1 < 0)
+            x1 = 0;
+        if (x2 >= (int64_t)oc.width)
+            x2 = (int64_t)oc.width - 1;
+    }
+    if (x1 > x2)
+        return;
+
+    olivec_fill_row_span(&OLIVEC_PIXEL(oc, x1, y), (size_t)(x2 - x1 + 1), color);
+}
+
+// Fills the pixels x1..x2 (inclusive) of the row y, clipped to the canvas. The row itself must be on the canvas
+void olivec_fill_row(Olivec_Canvas oc, int y, int64_t x1, int64_t x2, uint32_t color)
+{
+    olivec_fill_row_clip(oc, OLIVEC_STRADDLE, y, x1, x2, color);
+}
+
+// Draws c2 over *c1 with the alpha of c2. The alpha of *c1 is kept.
+// Red and blue share one 32 bit word as two 16 bit lanes, so the three channels take two multiplies per color
+// instead of three. Every lane stays below 65535, where (x + 1 + (x >> 8)) >> 8 is exactly x / 255.
+void olivec_blend_color(uint32_t *c1, uint32_t c2)
+{
+    uint32_t a2 = OLIVEC_ALPHA(c2);
+    uint32_t rb = (*c1 & 0x00FF00FF) * (255 - a2) + (c2 & 0x00FF00FF) * a2;
+    uint32_t g = ((*c1 >> 8) & 0x000000FF) * (255 - a2) + ((c2 >> 8) & 0x000000FF) * a2;
+    rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+    g = ((g + 1 + (g >> 8)) >> 8) & 0x000000FF;
+    *c1 = (*c1 & 0xFF000000) | rb | (g << 8);
+}
+
+// Draws color over *c1 with alpha a1 and over *c2 with alpha a2, the same as two olivec_blend_color() calls.
+// With SSE2 both pixels are widened to 16 bit lanes of one register and share every multiply.
+void olivec_blend_color_pair(uint32_t *c1, uint32_t *c2, uint32_t color, uint32_t a1, uint32_t a2)
+{
+#if defined(OLIVEC_X86) && defined(__SSE2__)
+    __m128i zero = _mm_setzero_si128();
+    __m128i dst = _mm_unpacklo_epi32(_mm_cvtsi32_si128((int)*c1), _mm_cvtsi32_si128((int)*c2));
+    dst = _mm_unpacklo_epi8(dst, zero);
+    __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+    __m128i a = _mm_unpacklo_epi64(_mm_set1_epi16((short)a1), _mm_set1_epi16((short)a2));
+    __m128i x = _mm_add_epi16(_mm_mullo_epi16(dst, _mm_sub_epi16(_mm_set1_epi16(255), a)), _mm_mullo_epi16(src, a));
+    x = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+    x = _mm_packus_epi16(x, x);
+    *c1 = (*c1 & 0xFF000000) | ((uint32_t)_mm_cvtsi128_si32(x) & 0x00FFFFFF);
+    *c2 = (*c2 & 0xFF000000) | ((uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x, 4)) & 0x00FFFFFF);
+#else
+    olivec_blend_color(c1, (color & 0x00FFFFFF) | (a1 << (8 * 3)));
+    olivec_blend_color(c2, (color & 0x00FFFFFF) | (a2 << (8 * 3)));
+#endif
+}
+
+#if defined(OLIVEC_X86) && defined(__SSE2__)
+// Blends four pixels at once like olivec_blend_color(): src is the color times its alpha and ia is 255 minus the
+// alpha, both in the 16 bit lanes of one pixel, repeated for the other one.
+__m128i olivec_blend_x4(__m128i dst, __m128i src, __m128i ia)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dst, zero), ia), src);
+    __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dst, zero), ia), src);
+    lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(lo, _mm_set1_epi16(1)), _mm_srli_epi16(lo, 8)), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(hi, _mm_set1_epi16(1)), _mm_srli_epi16(hi, 8)), 8);
+    __m128i mask = _mm_set1_epi32((int)0xFF000000);
+    return _mm_or_si128(_mm_and_si128(dst, mask), _mm_andnot_si128(mask, _mm_packus_epi16(lo, hi)));
+}
+#endif
+
+// Draws color with alpha a over each of the four pixels once, even where the same pixel is passed more than once.
+// NULL pixels are skipped. With SSE2 the four pixels share one register and every multiply.
+void olivec_blend_color_quad(uint32_t *c1, uint32_t *c2, uint32_t *c3, uint32_t *c4, uint32_t color, uint32_t a)
+{
+#if defined(OLIVEC_X86) && defined(__SSE2__)
+    __m128i dst = _mm_set_epi32(c4 ? (int)*c4 : 0, c3 ? (int)*c3 : 0, c2 ? (int)*c2 : 0, c1 ? (int)*c1 : 0);
+    __m128i src = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128()), _mm_set1_epi16((short)a));
+    __m128i x = olivec_blend_x4(dst, src, _mm_set1_epi16((short)(255 - a)));
+    if (c1)
+        *c1 = (uint32_t)_mm_cvtsi128_si32(x);
+    if (c2)
+        *c2 = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x, 4));
+    if (c3)
+        *c3 = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+    if (c4)
+        *c4 = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(x, 12));
+#else
+    uint32_t c = (color & 0x00FFFFFF) | (a << (8 * 3));
+    if (c1)
+        olivec_blend_color(c1, c);
+    if (c2 && c2 != c1)
+        olivec_blend_color(c2, c);
+    if (c3 && c3 != c1 && c3 != c2)
+        olivec_blend_color(c3, c);
+    if (c4 && c4 != c1 && c4 != c2 && c4 != c3)
+        olivec_blend_color(c4, c);
+#endif
+}
+
+// Blends color over the pixels x1..x2 (inclusive) of the row y, clipped to the canvas. With SSE2 four pixels at a time
+void olivec_blend_row(Olivec_Canvas oc, int y, int64_t x1, int64_t x2, uint32_t color)
+{
+    if (x1 < 0)
+        x1 = 0;
+    if (x2 >= (int64_t)oc.width)
+        x2 = (int64_t)oc.width - 1;
+    if (x1 > x2)
+        return;
+
+    uint32_t *pixel = &OLIVEC_PIXEL(oc, x1, y);
+    size_t count = (size_t)(x2 - x1 + 1);
+    size_t i = 0;
+#if defined(OLIVEC_X86) && defined(__SSE2__)
+    uint32_t a = OLIVEC_ALPHA(color);
+    __m128i src = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)color), _mm_setzero_si128()), _mm_set1_epi16((short)a));
+    __m128i ia = _mm_set1_epi16((short)(255 - a));
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i dst = _mm_loadu_si128((__m128i *)&pixel[i]);
+        _mm_storeu_si128((__m128i *)&pixel[i], olivec_blend_x4(dst, src, ia));
+    }
+    // The last one to three pixels in one more register
+    if (i < count)
+    {
+        uint32_t *second = i + 1 < count ? &pixel[i + 1] : NULL;
+        uint32_t *third = i + 2 < count ? &pixel[i + 2] : NULL;
+        olivec_blend_color_quad(&pixel[i], second, third, NULL, color, a);
+    }
+#else
+    for (; i < count; ++i)
+        olivec_blend_color(&pixel[i], color);
+#endif
+}
+
+// The range of the distances |p - c| of the pixels p in 0..size-1 to c
+void olivec_circle_distances(int64_t c, size_t size, int64_t *from, int64_t *to)
+{
+    int64_t last = (int64_t)size - 1;
+    int64_t a = c < 0 ? -c : c;
+    int64_t b = c < last ? last - c : c - last;
+    *from = c < 0 || c > last ? (a < b ? a : b) : 0;
+    *to = a > b ? a : b;
+}
+
+// Classifies the bounding box of a circle of radius r and clips its vertical range to the canvas. Unless the circle
+// is OLIVEC_OUTSIDE, sets the range of |dy| to walk outwards from the row closest to the center.
+Olivec_Clip olivec_circle_visible_rows(size_t width, size_t height, int cx, int cy, int64_t r, int64_t *top, int64_t *bottom, int64_t *dy_min, int64_t *dy_max)
+{
+    Olivec_Clip clip = olivec_clip_size(width, height, cx - r, cy - r, cx + r, cy + r);
+    if (clip == OLIVEC_OUTSIDE)
+        return clip;
+
+    *top = (int64_t)cy - r;
+    *bottom = (int64_t)cy + r;
+    if (*top < 0)
+        *top = 0;
+    if (*bottom >= (int64_t)height)
+        *bottom = (int64_t)height - 1;
+    if (*top > *bottom)
+        return OLIVEC_OUTSIDE;
+
+    *dy_min = cy < *top ? *top - cy : cy > *bottom ? cy - *bottom : 0;
+    *dy_max = cy - *top > *bottom - cy ? cy - *top : *bottom - cy;
+    return clip;
+}
+
+// Every radius up to OLIVEC_SPAN_CACHE_MAX_RADIUS that olivec_fill_circle() draws keeps its row half widths in one of
+// OLIVEC_SPAN_CACHE_SLOTS slots, evicting the least recently used radius. The tables are static, so this works without
+// an allocator too. With threads every thread has a cache of its own, so circles can be filled from several threads
+// at once without a lock; the hits and misses and olivec_span_cache_reset() are those of the calling thread.
+#ifndef OLIVEC_SPAN_CACHE_SLOTS
+#define OLIVEC_SPAN_CACHE_SLOTS 16
+#endif
+
+#ifndef OLIVEC_SPAN_CACHE_MAX_RADIUS
+#define OLIVEC_SPAN_CACHE_MAX_RADIUS 256
+#endif
+
+typedef struct
+{
+    // 0 for a slot that was never filled
+    int64_t radius;
+    uint64_t last_used;
+    // widths[dy] is the half width of the row dy away from the center
+    uint16_t widths[OLIVEC_SPAN_CACHE_MAX_RADIUS + 1];
+} Olivec_Span_Cache_Slot;
+
+typedef struct
+{
+    Olivec_Span_Cache_Slot slots[OLIVEC_SPAN_CACHE_SLOTS];
+    uint64_t clock;
+    // Lookups that found their radius and lookups that had to compute it, for sizing the cache
+    size_t hits;
+    size_t misses;
+} Olivec_Span_Cache;
+
+#ifdef OLIVEC_THREADS
+_Thread_local
+#endif
+Olivec_Span_Cache olivec_span_cache = {0};
+
+// Returns the half widths of a circle of radius r, or NULL if r is too big to be cached
+const uint16_t *olivec_span_cache_lookup(int64_t r)
+{
+    if (r <= 0 || r > OLIVEC_SPAN_CACHE_MAX_RADIUS)
+        return NULL;
+
+    Olivec_Span_Cache *cache = &olivec_span_cache;
+    cache->clock += 1;
+
+    Olivec_Span_Cache_Slot *victim = &cache->slots[0];
+    for (size_t i = 0; i < OLIVEC_SPAN_CACHE_SLOTS; ++i)
+    {
+        Olivec_Span_Cache_Slot *slot = &cache->slots[i];
+        if (slot->radius == r)
+        {
+            slot->last_used = cache->clock;
+            cache->hits += 1;
+            return slot->widths;
+        }
+        if (slot->last_used < victim->last_used)
+            victim = slot;
+    }
+
+    cache->misses += 1;
+    victim->radius = r;
+    victim->last_used = cache->clock;
+    int64_t w = r;
+    for (int64_t dy = 0; dy <= r; ++dy)
+    {
+        while (w * w + dy * dy > r * r)
+            w -= 1;
+        victim->widths[dy] = (uint16_t)w;
+    }
+    return victim->widths;
+}
+
+// Forgets every cached radius. Only the keys and stamps are cleared: assigning a zeroed struct would compile to a
+// memset() call, which the wasm build has no libc for
+void olivec_span_cache_reset(void)
+{
+    Olivec_Span_Cache *cache = &olivec_span_cache;
+    for (size_t i = 0; i < OLIVEC_SPAN_CACHE_SLOTS; ++i)
+    {
+        cache->slots[i].radius = 0;
+        cache->slots[i].last_used = 0;
+    }
+    cache->clock = 0;
+    cache->hits = 0;
+    cache->misses = 0;
+}
+
+// Walks the visible rows of a filled circle top to bottom, the pixels with dx*dx + dy*dy <= r*r. Shared by the native
+// primitives and the ones of every other pixel format, like Olivec_Triangle.
+typedef struct
+{
+    Olivec_Clip clip;
+    int64_t cx;
+    int64_t cy;
+    // The next row and the last one, clipped to the canvas
+    int64_t y;
+    int64_t bottom;
+    int64_t rr;
+    // Half width of the previous row, stepped to the next one: it only grows above the center and only shrinks below
+    int64_t w;
+    // Half widths of the radius from the span cache, or NULL to step w
+    const uint16_t *widths;
+} Olivec_Circle_Rows;
+
+// Returns false if nothing of the circle is visible. With `cached` the half widths come from the span cache, so this
+// is not safe to call from several threads at once.
+bool olivec_circle_rows_init(Olivec_Circle_Rows *c, int cx, int cy, int r, size_t width, size_t height, bool cached)
+{
+    if (r == 0)
+        return false;
+
+    int64_t r64 = r < 0 ? -(int64_t)r : r;
+    int64_t top, bottom, dy_min, dy_max;
+    c->clip = olivec_circle_visible_rows(width, height, cx, cy, r64, &top, &bottom, &dy_min, &dy_max);
+    if (c->clip == OLIVEC_OUTSIDE)
+        return false;
+
+    c->cx = cx;
+    c->cy = cy;
+    c->y = top;
+    c->bottom = bottom;
+    c->rr = r64 * r64;
+    int64_t dy = top < cy ? cy - top : top - cy;
+    c->w = (int64_t)olivec_isqrt((uint64_t)(c->rr - dy * dy));
+    // Off-canvas circles are rejected above, before they can evict a cached radius
+    c->widths = cached ? olivec_span_cache_lookup(r64) : NULL;
+    return true;
+}
+
+// Sets the span x1..x2 (inclusive, unclipped) of the row c->y and moves on to the next row
+void olivec_circle_rows_step(Olivec_Circle_Rows *c, int64_t *x1, int64_t *x2)
+{
+    int64_t dy = c->y < c->cy ? c->cy - c->y : c->y - c->cy;
+    int64_t w;
+    if (c->widths != NULL)
+    {
+        w = c->widths[dy];
+    }
+    else
+    {
+        while ((c->w + 1) * (c->w + 1) + dy * dy <= c->rr)
+            c->w += 1;
+        while (c->w * c->w + dy * dy > c->rr)
+            c->w -= 1;
+        w = c->w;
+    }
+    *x1 = c->cx - w;
+    *x2 = c->cx + w;
+    c->y += 1;
+}
+
+// olivec_fill_circle() without the damage report and the span cache, for callers that report their own bounds or run
+// on the thread pool
+void olivec_fill_circle_rows(Olivec_Canvas oc, int cx, int cy, int r, uint32_t color)
+{
+    Olivec_Circle_Rows c;
+    if (!olivec_circle_rows_init(&c, cx, cy, r, oc.width, oc.height, false))
+        return;
+
+    while (c.y <= c.bottom)
+    {
+        int y = (int)c.y;
+        int64_t x1, x2;
+        olivec_circle_rows_step(&c, &x1, &x2);
+        olivec_fill_row_clip(oc, c.clip, y, x1, x2, color);
+    }
+}
+
+void olivec_fill_circle(Olivec_Canvas oc, int cx, int cy, int r, uint32_t color)
+{
+    if (r == 0)
+        return;
+
+    int64_t r64 = r < 0 ? -(int64_t)r : r;
+    olivec_damage_bounds(oc, cx - r64, cy - r64, cx + r64, cy + r64);
+
+    Olivec_Circle_Rows c;
+    if (!olivec_circle_rows_init(&c, cx, cy, r, oc.width, oc.height, true))
+        return;
+
+    while (c.y <= c.bottom)
+    {
+        int y = (int)c.y;
+        int64_t x1, x2;
+        olivec_circle_rows_step(&c, &x1, &x2);
+        olivec_fill_row_clip(oc, c.clip, y, x1, x2, color);
+    }
+}
+
+// Batched circles are binned into square tiles of this many pixels, which are rasterized independently
+#ifndef OLIVEC_TILE_SIZE
+#define OLIVEC_TILE_SIZE 64
+#endif
+
+typedef struct
+{
+    int x;
+    int y;
+    int r;
+    uint32_t color;
+} Olivec_Circle;
+
+typedef struct
+{
+    Olivec_Canvas oc;
+    size_t tiles_x;
+    // The circles overlapping tile t are circles[offsets[t]..offsets[t + 1]), in the order they were passed in.
+    // They are copied rather than indexed, so a tile reads its circles front to back instead of gathering them from
+    // all over the input arrays
+    const size_t *offsets;
+    const Olivec_Circle *circles;
+} Olivec_Circle_Bins;
+
+void olivec_fill_circles_job(void *ctx, size_t begin, size_t end)
+{
+    Olivec_Circle_Bins *bins = ctx;
+    for (size_t t = begin; t < end; ++t)
+    {
+        int x0 = (int)(t % bins->tiles_x * OLIVEC_TILE_SIZE);
+        int y0 = (int)(t / bins->tiles_x * OLIVEC_TILE_SIZE);
+        Olivec_Canvas tile = olivec_subcanvas(bins->oc, x0, y0, OLIVEC_TILE_SIZE, OLIVEC_TILE_SIZE);
+        for (size_t k = bins->offsets[t]; k < bins->offsets[t + 1]; ++k)
+        {
+            Olivec_Circle c = bins->circles[k];
+            olivec_fill_circle_rows(tile, c.x - x0, c.y - y0, c.r, c.color);
+        }
+    }
+}
+
+// Clips the bounding box of a circle to the canvas. Returns false when it is not visible at all
+bool olivec_circle_clip_bounds(Olivec_Canvas oc, int cx, int cy, int r, Olivec_Normalized_Rect *nr)
+{
+    if (r == 0)
+        return false;
+    int64_t r64 = r < 0 ? -(int64_t)r : r;
+    int64_t x1 = cx - r64 < 0 ? 0 : cx - r64;
+    int64_t y1 = cy - r64 < 0 ? 0 : cy - r64;
+    int64_t x2 = cx + r64 >= (int64_t)oc.width ? (int64_t)oc.width - 1 : cx + r64;
+    int64_t y2 = cy + r64 >= (int64_t)oc.height ? (int64_t)oc.height - 1 : cy + r64;
+    if (x1 > x2 || y1 > y2)
+        return false;
+    nr->x1 = (int)x1;
+    nr->y1 = (int)y1;
+    nr->x2 = (int)x2;
+    nr->y2 = (int)y2;
+    return true;
+}
+
+// Draws count circles given as separate arrays of centers, radii and colors, with the same result as calling
+// olivec_fill_circle() on each of them in order. The circles are binned into OLIVEC_TILE_SIZE tiles first; every tile
+// then draws its own circles, clipped to the tile, so it stays in cache while they are drawn and the tiles can be
+// split across the thread pool. Without libc there is nothing to allocate the bins from, so the circles are drawn one
+// by one.
+void olivec_fill_circles(Olivec_Canvas oc, const int *xs, const int *ys, const int *rs, const uint32_t *colors, size_t count)
+{
+    // One pass for the damage bounds and the number of tile entries
+    Olivec_Normalized_Rect bounds = {0};
+    bool visible = false;
+    size_t entries = 0;
+    size_t cost = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Olivec_Normalized_Rect nr;
+        if (!olivec_circle_clip_bounds(oc, xs[i], ys[i], rs[i], &nr))
+            continue;
+        if (!visible)
+        {
+            bounds = nr;
+            visible = true;
+        }
+        if (nr.x1 < bounds.x1)
+            bounds.x1 = nr.x1;
+        if (nr.y1 < bounds.y1)
+            bounds.y1 = nr.y1;
+        if (nr.x2 > bounds.x2)
+            bounds.x2 = nr.x2;
+        if (nr.y2 > bounds.y2)
+            bounds.y2 = nr.y2;
+        entries += (size_t)(nr.x2 / OLIVEC_TILE_SIZE - nr.x1 / OLIVEC_TILE_SIZE + 1) *
+                   (size_t)(nr.y2 / OLIVEC_TILE_SIZE - nr.y1 / OLIVEC_TILE_SIZE + 1);
+        cost += (size_t)(nr.x2 - nr.x1 + 1) * (size_t)(nr.y2 - nr.y1 + 1);
+    }
+    if (!visible)
+        return;
+    olivec_damage_rect(oc, bounds);
+
+#ifndef OLIVEC_FREESTANDING
+    size_t tiles_x = (oc.width + OLIVEC_TILE_SIZE - 1) / OLIVEC_TILE_SIZE;
+    size_t tiles_y = (oc.height + OLIVEC_TILE_SIZE - 1) / OLIVEC_TILE_SIZE;
+    size_t tiles = tiles_x * tiles_y;
+    size_t *offsets = calloc(tiles + 1, sizeof(*offsets));
+    Olivec_Circle *circles = malloc(entries * sizeof(*circles));
+    if (offsets != NULL && circles != NULL)
+    {
+        // Count the circles of every tile, turn the counts into offsets, then scatter the circles. The scatter goes
+        // through them in order, so every tile keeps the painter's order
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                Olivec_Normalized_Rect nr;
+                if (!olivec_circle_clip_bounds(oc, xs[i], ys[i], rs[i], &nr))
+                    continue;
+                for (size_t ty = (size_t)nr.y1 / OLIVEC_TILE_SIZE; ty <= (size_t)nr.y2 / OLIVEC_TILE_SIZE; ++ty)
+                {
+                    for (size_t tx = (size_t)nr.x1 / OLIVEC_TILE_SIZE; tx <= (size_t)nr.x2 / OLIVEC_TILE_SIZE; ++tx)
+                    {
+                        size_t t = ty * tiles_x + tx;
+                        if (pass == 0)
+                            offsets[t + 1] += 1;
+                        else
+                            circles[offsets[t]++] = (Olivec_Circle){xs[i], ys[i], rs[i], colors[i]};
+                    }
+                }
+            }
+
+            if (pass == 0)
+            {
+                for (size_t t = 0; t < tiles; ++t)
+                    offsets[t + 1] += offsets[t];
+            }
+            else
+            {
+                // The scatter advanced every offset to the start of the next tile
+                for (size_t t = tiles; t > 0; --t)
+                    offsets[t] = offsets[t - 1];
+                offsets[0] = 0;
+            }
+        }
+
+        Olivec_Circle_Bins bins = {
+            .oc = oc,
+            .tiles_x = tiles_x,
+            .offsets = offsets,
+            .circles = circles,
+        };
+        olivec_parallel_for(tiles, cost, olivec_fill_circles_job, &bins);
+        free(offsets);
+        free(circles);
+        return;
+    }
+    free(offsets);
+    free(circles);
+#else
+    (void)entries;
+    (void)cost;
+#endif
+
+    for (size_t i = 0; i < count; ++i)
+        olivec_fill_circle_rows(oc, xs[i], ys[i], rs[i], colors[i]);
+}
+
+// Coverage of an anti-aliased circle edge pixel from e, its distance to the edge scaled by 255 in 16.16 fixed point,
+// multiplied into the alpha of the color. (x + 1 + (x >> 8)) >> 8 is x / 255, as in olivec_blend_color().
+uint32_t olivec_circle_edge_alpha(int64_t e, uint32_t alpha)
+{
+    int64_t coverage = 128 + e / 65536;
+    if (coverage < 0)
+        coverage = 0;
+    if (coverage > 255)
+        coverage = 255;
+    uint32_t x = alpha * (uint32_t)coverage;
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+void olivec_fill_circle_aa(Olivec_Canvas oc, int cx, int cy, int r, uint32_t color)
+{
+    if (r == 0)
+        return;
+
+    int64_t r64 = r < 0 ? -(int64_t)r : r;
+    olivec_damage_bounds(oc, cx - r64, cy - r64, cx + r64, cy + r64);
+
+    int64_t top, bottom, dy_min, dy_max;
+    Olivec_Clip clip = olivec_circle_visible_rows(oc.width, oc.height, cx, cy, r64, &top, &bottom, &dy_min, &dy_max);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    // Same outward walk as olivec_fill_circle, but with two half widths per row: pixels within inner (centers at most
+    // r - 1/2 away) are fully covered and filled as one span, pixels past outer (at least r + 1/2 away) are not covered
+    // at all, and only the band in between gets blended. For integer squared distances those bounds are r*r - r and
+    // r*r + r, which unlike (2*r + 1)^2 still fit an int64_t for every int radius.
+    int64_t rr_inner = r64 * r64 - r64;
+    int64_t rr_outer = r64 * r64 + r64;
+    // On the center row they are r - 1 and r, which saves both square roots whenever the center row is visible
+    int64_t inner = r64 - 1;
+    int64_t outer = r64;
+    if (dy_min != 0)
+    {
+        inner = rr_inner >= dy_min * dy_min ? (int64_t)olivec_isqrt((uint64_t)(rr_inner - dy_min * dy_min)) : -1;
+        outer = (int64_t)olivec_isqrt((uint64_t)(rr_outer - dy_min * dy_min));
+    }
+    uint32_t alpha = OLIVEC_ALPHA(color);
+    bool opaque = alpha == 255;
+
+    // Only the |dx| that put a pixel of the band on the canvas are walked
+    int64_t dx_from, dx_to;
+    olivec_circle_distances(cx, oc.width, &dx_from, &dx_to);
+
+    // The distance of a pixel center to the edge is r - sqrt(d2) ~ (r*r - d2)/(2*r), which is exact enough inside the
+    // band. scale is 255/(2*r) in 16.16 fixed point, and along a row the scaled distance e only changes by de, which
+    // itself changes by -2*scale per pixel, so a coverage costs two adds. It is the same for the four mirrors
+    // (+-dx, +-dy), which are blended together.
+    int64_t scale = ((int64_t)255 << 16) / (2 * r64);
+    for (int64_t dy = dy_min; dy <= dy_max; ++dy)
+    {
+        while (inner >= 0 && inner * inner + dy * dy > rr_inner)
+            inner -= 1;
+        while (outer >= 0 && outer * outer + dy * dy > rr_outer)
+            outer -= 1;
+
+        uint32_t *rows[2] = {NULL, NULL};
+        if (cy - dy >= top)
+            rows[0] = &OLIVEC_PIXEL(oc, 0, cy - dy);
+        if (dy != 0 && cy + dy <= bottom)
+            rows[1] = &OLIVEC_PIXEL(oc, 0, cy + dy);
+
+        int64_t dx1 = inner + 1 > dx_from ? inner + 1 : dx_from;
+        int64_t dx2 = outer < dx_to ? outer : dx_to;
+        int64_t e = dx1 <= dx2 ? (r64 * r64 - dx1 * dx1 - dy * dy) * scale : 0;
+        int64_t de = dx1 <= dx2 ? -(2 * dx1 + 1) * scale : 0;
+        for (int64_t dx = dx1; dx <= dx2; ++dx)
+        {
+            // The coverage only falls further with dx
+            uint32_t a = olivec_circle_edge_alpha(e, alpha);
+            if (a == 0)
+                break;
+            e += de;
+            de -= 2 * scale;
+
+            int64_t left = cx - dx;
+            int64_t right = cx + dx;
+            bool left_visible = clip == OLIVEC_INSIDE || (left >= 0 && left < (int64_t)oc.width);
+            bool right_visible = clip == OLIVEC_INSIDE || (right >= 0 && right < (int64_t)oc.width);
+            olivec_blend_color_quad(rows[0] != NULL && left_visible ? rows[0] + left : NULL,
+                                    rows[0] != NULL && right_visible ? rows[0] + right : NULL,
+                                    rows[1] != NULL && left_visible ? rows[1] + left : NULL,
+                                    rows[1] != NULL && right_visible ? rows[1] + right : NULL, color, a);
+        }
+
+        if (inner < 0)
+            continue;
+        for (int side = 0; side < 2; ++side)
+        {
+            if (rows[side] == NULL)
+                continue;
+            int y = (int)(side == 0 ? cy - dy : cy + dy);
+            if (opaque)
+                olivec_fill_row_clip(oc, clip, y, cx - inner, cx + inner, color);
+            else
+                olivec_blend_row(oc, y, cx - inner, cx + inner, color);
+        }
+    }
+}
+
+// Plots the mirrors of the first octant midpoint step (x, y) around the center, each pixel once: the mirrors coincide
+// on the axes (x == 0) and on the diagonals (x == y)
+void olivec_plot_circle_octants(Olivec_Canvas oc, Olivec_Clip clip, int64_t cx, int64_t cy, int64_t x, int64_t y, uint32_t color)
+{
+    int64_t points[8][2] = {
+        {x, y}, {x, -y}, {y, x}, {-y, x},
+        {-x, y}, {-x, -y}, {y, -x}, {-y, -x},
+    };
+    int count = x == 0 || x == y ? 4 : 8;
+    if (x == y)
+    {
+        points[2][0] = -x;
+        points[2][1] = y;
+        points[3][0] = -x;
+        points[3][1] = -y;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        int64_t px = cx + points[i][0];
+        int64_t py = cy + points[i][1];
+        if (clip == OLIVEC_INSIDE || (0 <= px && px < (int64_t)oc.width && 0 <= py && py < (int64_t)oc.height))
+            OLIVEC_PIXEL(oc, px, py) = color;
+    }
+}
+
+// Midpoint stepping over the steps x in x_from..x_to of the first octant of the circle. d is the doubled distance of
+// the midpoint between the two candidate pixels to the circle, and only ever changes by small integers. Stepping from
+// (0, r) keeps x*x + y*y - y < r*r with the largest such y, so any step is a valid start.
+void olivec_draw_circle_steps(Olivec_Canvas oc, Olivec_Clip clip, int64_t cx, int64_t cy, int64_t r, int64_t x_from, int64_t x_to, uint32_t color)
+{
+    if (x_from > x_to || x_from > r)
+        return;
+
+    int64_t x = x_from;
+    int64_t rr = r * r - x * x;
+    int64_t y = (int64_t)olivec_isqrt((uint64_t)rr);
+    if ((y + 1) * y < rr)
+        y += 1;
+    int64_t d = 2 * x + 1 + y * y - y - rr;
+    while (x <= y && x <= x_to)
+    {
+        olivec_plot_circle_octants(oc, clip, cx, cy, x, y, color);
+        if (d < 0)
+        {
+            d += 2 * x + 3;
+        }
+        else
+        {
+            d += 2 * (x - y) + 5;
+            y -= 1;
+        }
+        x += 1;
+    }
+}
+
+void olivec_draw_circle(Olivec_Canvas oc, int cx, int cy, int r, uint32_t color)
+{
+    if (r == 0)
+        return;
+    int64_t r64 = r < 0 ? -(int64_t)r : r;
+
+    olivec_damage_bounds(oc, cx - r64, cy - r64, cx + r64, cy + r64);
+
+    Olivec_Clip clip = olivec_clip_bounds(oc, cx - r64, cy - r64, cx + r64, cy + r64);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    // Only the steps x that put one of the mirrors on the canvas are walked, so a huge circle costs as much as the
+    // pixels it can plot: at most a width and a height worth of steps
+    int64_t from[2], to[2];
+    olivec_circle_distances(cx, oc.width, &from[0], &to[0]);
+    olivec_circle_distances(cy, oc.height, &from[1], &to[1]);
+    if (from[0] > from[1])
+    {
+        OLIVEC_SWAP(int64_t, from[0], from[1]);
+        OLIVEC_SWAP(int64_t, to[0], to[1]);
+    }
+    olivec_draw_circle_steps(oc, clip, cx, cy, r64, from[0], to[0], color);
+    if (from[1] <= to[0])
+        from[1] = to[0] + 1;
+    olivec_draw_circle_steps(oc, clip, cx, cy, r64, from[1], to[1], color);
+}
+
+// Half widths of the rows of a ring, stepped outwards from the center like in olivec_fill_circle. The ring is the
+// pixels of olivec_fill_circle(outer) that are not part of olivec_fill_circle(inner). Each half width w keeps the
+// midpoint error w*w + dy*dy - r*r of its circle, so only the first row takes a square root and every later row and
+// every narrowing is a subtraction.
+typedef struct
+{
+    int64_t dy;
+    int64_t inner;
+    int64_t outer;
+    int64_t inner_err;
+    int64_t outer_err;
+} Olivec_Ring_Rows;
+
+void olivec_ring_rows_init(Olivec_Ring_Rows *rows, int64_t inner, int64_t outer, int64_t dy)
+{
+    rows->dy = dy;
+    rows->inner = inner >= dy ? (int64_t)olivec_isqrt((uint64_t)(inner * inner - dy * dy)) : -1;
+    rows->outer = (int64_t)olivec_isqrt((uint64_t)(outer * outer - dy * dy));
+    // olivec_fill_circle(0) draws nothing, so there is no hole to cut out
+    if (inner == 0)
+        rows->inner = -1;
+    rows->inner_err = rows->inner * rows->inner + dy * dy - inner * inner;
+    rows->outer_err = rows->outer * rows->outer + dy * dy - outer * outer;
+}
+
+// Moves to the row dy, which is the row of the last step or the one after it
+void olivec_ring_rows_step(Olivec_Ring_Rows *rows, int64_t dy)
+{
+    if (dy != rows->dy)
+    {
+        rows->inner_err += 2 * rows->dy + 1;
+        rows->outer_err += 2 * rows->dy + 1;
+        rows->dy = dy;
+    }
+    while (rows->inner >= 0 && rows->inner_err > 0)
+    {
+        rows->inner_err -= 2 * rows->inner - 1;
+        rows->inner -= 1;
+    }
+    while (rows->outer >= 0 && rows->outer_err > 0)
+    {
+        rows->outer_err -= 2 * rows->outer - 1;
+        rows->outer -= 1;
+    }
+}
+
+void olivec_fill_ring(Olivec_Canvas oc, int cx, int cy, int inner, int outer, uint32_t color)
+{
+    int64_t ri = inner < 0 ? -(int64_t)inner : inner;
+    int64_t ro = outer < 0 ? -(int64_t)outer : outer;
+    if (ri > ro)
+        OLIVEC_SWAP(int64_t, ri, ro);
+    if (ri == ro)
+        return;
+
+    olivec_damage_bounds(oc, cx - ro, cy - ro, cx + ro, cy + ro);
+
+    int64_t top, bottom, dy_min, dy_max;
+    Olivec_Clip clip = olivec_circle_visible_rows(oc.width, oc.height, cx, cy, ro, &top, &bottom, &dy_min, &dy_max);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    Olivec_Ring_Rows rows;
+    olivec_ring_rows_init(&rows, ri, ro, dy_min);
+    for (int64_t dy = dy_min; dy <= dy_max; ++dy)
+    {
+        olivec_ring_rows_step(&rows, dy);
+        for (int side = 0; side < 2; ++side)
+        {
+            if (side == 1 && dy == 0)
+                break;
+            int64_t y = side == 0 ? cy - dy : cy + dy;
+            if (y < top || y > bottom)
+                continue;
+
+            if (rows.inner < 0)
+            {
+                olivec_fill_row_clip(oc, clip, (int)y, cx - rows.outer, cx + rows.outer, color);
+            }
+            else
+            {
+                olivec_fill_row_clip(oc, clip, (int)y, cx - rows.outer, cx - rows.inner - 1, color);
+                olivec_fill_row_clip(oc, clip, (int)y, cx + rows.inner + 1, cx + rows.outer, color);
+            }
+        }
+    }
+}
+
+// Range reduced polynomial, good to about 1e-6. The wasm build has no libm to provide one
+float olivec_sinf(float x)
+{
+    // Reduce to [-pi, pi], then fold onto [-pi/2, pi/2] with sin(pi - x) = sin(x)
+    float turns = x / (2 * OLIVEC_PI);
+    int64_t whole = (int64_t)(turns + (turns >= 0 ? 0.5f : -0.5f));
+    x -= (float)whole * 2 * OLIVEC_PI;
+    if (x > OLIVEC_PI / 2)
+        x = OLIVEC_PI - x;
+    if (x < -OLIVEC_PI / 2)
+        x = -OLIVEC_PI - x;
+
+    float x2 = x * x;
+    return x * (1 - x2 / 6 * (1 - x2 / 20 * (1 - x2 / 42 * (1 - x2 / 72 * (1 - x2 / 110)))));
+}
+
+float olivec_cosf(float x)
+{
+    return olivec_sinf(x + OLIVEC_PI / 2);
+}
+
+// Fixed point scale of the direction vectors the sector edges are tested against
+#define OLIVEC_ARC_ONE (1 << 24)
+
+typedef struct
+{
+    int64_t x1;
+    int64_t x2;
+} Olivec_Span;
+
+int64_t olivec_div_floor(int64_t n, int64_t d)
+{
+    int64_t q = n / d;
+    if ((n % d != 0) && ((n < 0) != (d < 0)))
+        q -= 1;
+    return q;
+}
+
+// Narrows the span of the row dy to the pixels with a*dx + b*dy >= 0
+void olivec_half_plane_span(int64_t a, int64_t b, int64_t dy, Olivec_Span *span)
+{
+    int64_t c = b * dy;
+    if (a > 0)
+    {
+        int64_t x1 = -olivec_div_floor(c, a);
+        if (x1 > span->x1)
+            span->x1 = x1;
+    }
+    else if (a < 0)
+    {
+        int64_t x2 = olivec_div_floor(c, -a);
+        if (x2 < span->x2)
+            span->x2 = x2;
+    }
+    else if (c < 0)
+    {
+        span->x1 = 1;
+        span->x2 = 0;
+    }
+}
+
+// Fills a sector of the ring between the radii inner and outer. Angles are in radians and go clockwise on the screen
+// (y points down) from the positive x axis, so the sector is swept from start_angle to end_angle in that direction.
+// A sweep of 2*pi or more fills the whole ring; with inner == 0 this is a pie slice.
+void olivec_fill_arc(Olivec_Canvas oc, int cx, int cy, int inner, int outer, float start_angle, float end_angle, uint32_t color)
+{
+    float sweep = end_angle - start_angle;
+    if (sweep >= 2 * OLIVEC_PI)
+    {
+        olivec_fill_ring(oc, cx, cy, inner, outer, color);
+        return;
+    }
+    if (sweep < 0)
+    {
+        // An end before the start wraps around, like it does for arcs on an HTML canvas
+        int64_t turns = (int64_t)(sweep / (2 * OLIVEC_PI)) - 1;
+        sweep -= (float)turns * 2 * OLIVEC_PI;
+        if (sweep >= 2 * OLIVEC_PI)
+            sweep -= 2 * OLIVEC_PI;
+    }
+    // Both edges of an empty sector are the same ray, which is all the half planes below would leave of it
+    if (sweep == 0)
+        return;
+
+    int64_t ri = inner < 0 ? -(int64_t)inner : inner;
+    int64_t ro = outer < 0 ? -(int64_t)outer : outer;
+    if (ri > ro)
+        OLIVEC_SWAP(int64_t, ri, ro);
+    if (ri == ro)
+        return;
+
+    olivec_damage_bounds(oc, cx - ro, cy - ro, cx + ro, cy + ro);
+
+    int64_t top, bottom, dy_min, dy_max;
+    Olivec_Clip clip = olivec_circle_visible_rows(oc.width, oc.height, cx, cy, ro, &top, &bottom, &dy_min, &dy_max);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    // The sector is bounded by the half planes on the inner side of its two edges: their intersection for sweeps up
+    // to pi (plus the half plane around the bisector, which drops the opposite ray that both edges also contain),
+    // their union for wider sweeps. On every row each half plane is a half line of dx, so a row of the sector is
+    // at most two spans, and a row of the ring sector at most four.
+    int64_t sx = (int64_t)(olivec_cosf(start_angle) * OLIVEC_ARC_ONE);
+    int64_t sy = (int64_t)(olivec_sinf(start_angle) * OLIVEC_ARC_ONE);
+    int64_t ex = (int64_t)(olivec_cosf(start_angle + sweep) * OLIVEC_ARC_ONE);
+    int64_t ey = (int64_t)(olivec_sinf(start_angle + sweep) * OLIVEC_ARC_ONE);
+    int64_t mx = (int64_t)(olivec_cosf(start_angle + sweep / 2) * OLIVEC_ARC_ONE);
+    int64_t my = (int64_t)(olivec_sinf(start_angle + sweep / 2) * OLIVEC_ARC_ONE);
+    bool wide = sweep > OLIVEC_PI;
+
+    Olivec_Ring_Rows rows;
+    olivec_ring_rows_init(&rows, ri, ro, dy_min);
+    for (int64_t dy = dy_min; dy <= dy_max; ++dy)
+    {
+        olivec_ring_rows_step(&rows, dy);
+        for (int side = 0; side < 2; ++side)
+        {
+            if (side == 1 && dy == 0)
+                break;
+            int64_t y = side == 0 ? cy - dy : cy + dy;
+            if (y < top || y > bottom)
+                continue;
+            int64_t row_dy = y - cy;
+
+            Olivec_Span ring[2];
+            size_t ring_count = 0;
+            if (rows.inner < 0)
+            {
+                ring[ring_count++] = (Olivec_Span){-rows.outer, rows.outer};
+            }
+            else
+            {
+                ring[ring_count++] = (Olivec_Span){-rows.outer, -rows.inner - 1};
+                ring[ring_count++] = (Olivec_Span){rows.inner + 1, rows.outer};
+            }
+
+            Olivec_Span sector[2];
+            size_t sector_count = 0;
+            Olivec_Span start_side = {-rows.outer, rows.outer};
+            Olivec_Span end_side = {-rows.outer, rows.outer};
+            olivec_half_plane_span(-sy, sx, row_dy, &start_side);
+            olivec_half_plane_span(ey, -ex, row_dy, &end_side);
+            if (!wide)
+            {
+                Olivec_Span both = {
+                    start_side.x1 > end_side.x1 ? start_side.x1 : end_side.x1,
+                    start_side.x2 < end_side.x2 ? start_side.x2 : end_side.x2,
+                };
+                olivec_half_plane_span(mx, my, row_dy, &both);
+                sector[sector_count++] = both;
+            }
+            else if (start_side.x1 > start_side.x2 || end_side.x1 > end_side.x2 ||
+                     (start_side.x1 <= end_side.x2 + 1 && end_side.x1 <= start_side.x2 + 1))
+            {
+                // One of the half lines is empty, or they overlap: the union is a single span
+                bool start_empty = start_side.x1 > start_side.x2;
+                bool end_empty = end_side.x1 > end_side.x2;
+                Olivec_Span both = start_empty ? end_side : end_empty ? start_side : (Olivec_Span){
+                    start_side.x1 < end_side.x1 ? start_side.x1 : end_side.x1,
+                    start_side.x2 > end_side.x2 ? start_side.x2 : end_side.x2,
+                };
+                sector[sector_count++] = both;
+            }
+            else
+            {
+                sector[sector_count++] = start_side;
+                sector[sector_count++] = end_side;
+            }
+
+            for (size_t i = 0; i < ring_count; ++i)
+            {
+                for (size_t j = 0; j < sector_count; ++j)
+                {
+                    int64_t x1 = ring[i].x1 > sector[j].x1 ? ring[i].x1 : sector[j].x1;
+                    int64_t x2 = ring[i].x2 < sector[j].x2 ? ring[i].x2 : sector[j].x2;
+                    if (x1 <= x2)
+                        olivec_fill_row_clip(oc, clip, (int)y, cx + x1, cx + x2, color);
+                }
+            }
+        }
+    }
+}
+
+// Newton iterations from a guess with the exponent halved. The wasm build has no libm to provide one
+double olivec_sqrt(double x)
+{
+    if (x <= 0)
+        return 0;
+
+    union
+    {
+        double d;
+        uint64_t u;
+    } guess = {.d = x};
+    guess.u = (guess.u >> 1) + ((uint64_t)1023 << 51);
+
+    double y = guess.d;
+    for (int i = 0; i < 5; ++i)
+        y = 0.5 * (y + x / y);
+    return y;
+}
+
+// Fills the pixels with dx*dx/(rx*rx) + dy*dy/(ry*ry) <= 1. With rx == ry that is exactly olivec_fill_circle.
+void olivec_fill_ellipse(Olivec_Canvas oc, int cx, int cy, int rx, int ry, uint32_t color)
+{
+    if (rx == 0 || ry == 0)
+        return;
+
+    int64_t ax = rx < 0 ? -(int64_t)rx : rx;
+    int64_t ay = ry < 0 ? -(int64_t)ry : ry;
+
+    olivec_damage_bounds(oc, cx - ax, cy - ay, cx + ax, cy + ay);
+
+    Olivec_Clip clip = olivec_clip_bounds(oc, cx - ax, cy - ay, cx + ax, cy + ay);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    int64_t top = (int64_t)cy - ay;
+    int64_t bottom = (int64_t)cy + ay;
+    if (top < 0)
+        top = 0;
+    if (bottom >= (int64_t)oc.height)
+        bottom = (int64_t)oc.height - 1;
+    if (top > bottom)
+        return;
+
+    // Same outward walk as olivec_fill_circle: the half width w of a row is the largest one with
+    // w*w*ry*ry + dy*dy*rx*rx <= rx*rx*ry*ry, and only ever shrinks. That is exact in int64 as long as rx*ry < 2^31;
+    // beyond that the products are done in double, which is only off for pixels right on the edge.
+    int64_t dy_min = cy < top ? top - cy : cy > bottom ? cy - bottom : 0;
+    int64_t dy_max = cy - top > bottom - cy ? cy - top : bottom - cy;
+    bool exact = ax * ay < ((int64_t)1 << 31);
+    int64_t rx2 = ax * ax;
+    int64_t ry2 = ay * ay;
+    int64_t w = (int64_t)((double)ax * olivec_sqrt(1.0 - (double)dy_min * dy_min / (double)ry2)) + 1;
+    for (int64_t dy = dy_min; dy <= dy_max; ++dy)
+    {
+        if (exact)
+        {
+            while (w >= 0 && w * w * ry2 + dy * dy * rx2 > rx2 * ry2)
+                w -= 1;
+        }
+        else
+        {
+            while (w >= 0 && (double)w * w * ry2 + (double)dy * dy * rx2 > (double)rx2 * ry2)
+                w -= 1;
+        }
+        if (w < 0)
+            break;
+
+        if (cy - dy >= top)
+            olivec_fill_row_clip(oc, clip, (int)(cy - dy), cx - w, cx + w, color);
+        if (dy != 0 && cy + dy <= bottom)
+            olivec_fill_row_clip(oc, clip, (int)(cy + dy), cx - w, cx + w, color);
+    }
+}
+
+// Fills the ellipse with radii rx and ry rotated by angle radians, clockwise on the screen like olivec_fill_arc.
+// In the frame of the center it is A*dx*dx + B*dx*dy + C*dy*dy <= 1, so a row dy is the span between the two roots of a
+// quadratic in dx. Both the vertex -B*dy/(2*A) and the discriminant move along the rows by forward differences; every
+// row costs one square root and no pixel is tested on its own.
+void olivec_fill_ellipse_rotated(Olivec_Canvas oc, int cx, int cy, int rx, int ry, float angle, uint32_t color)
+{
+    if (rx == 0 || ry == 0)
+        return;
+
+    double c = olivec_cosf(angle);
+    double s = olivec_sinf(angle);
+    double rx2 = (double)rx * rx;
+    double ry2 = (double)ry * ry;
+    double A = c * c / rx2 + s * s / ry2;
+    double B = 2 * c * s * (1 / rx2 - 1 / ry2);
+    double C = s * s / rx2 + c * c / ry2;
+
+    // Half extents of the bounding box of the rotated ellipse
+    int64_t hw = (int64_t)olivec_sqrt(rx2 * c * c + ry2 * s * s) + 1;
+    int64_t hh = (int64_t)olivec_sqrt(rx2 * s * s + ry2 * c * c) + 1;
+
+    olivec_damage_bounds(oc, cx - hw, cy - hh, cx + hw, cy + hh);
+
+    Olivec_Clip clip = olivec_clip_bounds(oc, cx - hw, cy - hh, cx + hw, cy + hh);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+    int64_t top = (int64_t)cy - hh;
+    int64_t bottom = (int64_t)cy + hh;
+    if (top < 0)
+        top = 0;
+    if (bottom >= (int64_t)oc.height)
+        bottom = (int64_t)oc.height - 1;
+    if (top > bottom)
+        return;
+
+    // For the row dy the roots are (-B*dy +- sqrt(D(dy)))/(2*A) with D(dy) = (B*B - 4*A*C)*dy*dy + 4*A,
+    // so D steps by dD, which itself steps by ddD, and the vertex steps by a constant
+    double dy = (double)(top - cy);
+    double k = B * B - 4 * A * C;
+    double disc = k * dy * dy + 4 * A;
+    double ddisc = k * (2 * dy + 1);
+    double dddisc = 2 * k;
+    double vertex = -B * dy / (2 * A);
+    double dvertex = -B / (2 * A);
+    double inv_2a = 1 / (2 * A);
+    for (int64_t y = top; y <= bottom; ++y)
+    {
+        if (disc >= 0)
+        {
+            double half = olivec_sqrt(disc) * inv_2a;
+            double x1 = vertex - half;
+            double x2 = vertex + half;
+            // Pixel centers inside [x1, x2]: ceil(x1) .. floor(x2), done with casts that round towards zero
+            int64_t ix1 = (int64_t)x1;
+            if ((double)ix1 < x1)
+                ix1 += 1;
+            int64_t ix2 = (int64_t)x2;
+            if ((double)ix2 > x2)
+                ix2 -= 1;
+            if (ix1 <= ix2)
+                olivec_fill_row_clip(oc, clip, (int)y, cx + ix1, cx + ix2, color);
+        }
+        disc += ddisc;
+        ddisc += dddisc;
+        vertex += dvertex;
+    }
+}
+
+// A line clipped to the canvas, as the run of Bresenham steps k1..k2 that lands on it. Step k is one pixel along the
+// major axis and floor((2*k*minor + major) / (2*major)) pixels along the minor axis from the start of the line, the
+// exact line rounded half up, so both endpoints are drawn. Lines are walked with the major coordinate increasing,
+// which makes a line and its reverse the same pixels
+typedef struct
+{
+    bool steep;
+    // The walk goes from (x2, y2) to (x1, y1)
+    bool reversed;
+    int64_t major;
+    int64_t minor;
+    // Direction of x and y along the walk
+    int sx;
+    int sy;
+    // The visible steps, inclusive
+    int64_t k1;
+    int64_t k2;
+    // The pixel of step k1 and the error term there, 2*k1*minor + major modulo 2*major
+    int64_t x;
+    int64_t y;
+    int64_t err;
+} Olivec_Line;
+
+// Returns floor((2*k*minor + major) / (2*major)) and sets *err to the remainder. Coordinates are ints, so major can be
+// up to 2^32 and k*minor does not fit in 64 bits; k is multiplied in two 16 bit halves instead
+int64_t olivec_line_minor_steps(int64_t k, int64_t minor, int64_t major, int64_t *err)
+{
+    if (major == 0)
+    {
+        *err = 0;
+        return 0;
+    }
+    int64_t d = 2 * major;
+    int64_t hi = (k >> 16) * 2 * minor;
+    int64_t rest = (hi % d << 16) + (k & 0xFFFF) * 2 * minor + major;
+    *err = rest % d;
+    return (hi / d << 16) + rest / d;
+}
+
+// Returns the first step k in 0..major + 1 of a line that is at least target pixels along the minor axis.
+// Liang-Barsky gives the crossing in closed form; rounding it in floating point can be off by one step, which the
+// exact step count settles
+int64_t olivec_line_first_step(int64_t target, int64_t minor, int64_t major)
+{
+    if (minor == 0)
+        return target <= 0 ? 0 : major + 1;
+
+    double t = (double)(2 * target - 1) * (double)major / (double)(2 * minor);
+    int64_t k = t <= 0 ? 0 : t >= (double)(major + 1) ? major + 1 : (int64_t)t;
+    int64_t err;
+    while (k > 0 && olivec_line_minor_steps(k - 1, minor, major, &err) >= target)
+        k -= 1;
+    while (k <= major && olivec_line_minor_steps(k, minor, major, &err) < target)
+        k += 1;
+    return k;
+}
+
+// Sets up the walk of the whole line from (x1, y1) to (x2, y2), all of its steps visible
+void olivec_line_init(int x1, int y1, int x2, int y2, Olivec_Line *line)
+{
+    int64_t adx = x2 > x1 ? (int64_t)x2 - x1 : (int64_t)x1 - x2;
+    int64_t ady = y2 > y1 ? (int64_t)y2 - y1 : (int64_t)y1 - y2;
+    line->steep = ady > adx;
+    line->reversed = line->steep ? y1 > y2 : x1 > x2;
+    if (line->reversed)
+    {
+        OLIVEC_SWAP(int, x1, x2);
+        OLIVEC_SWAP(int, y1, y2);
+    }
+    line->major = line->steep ? ady : adx;
+    line->minor = line->steep ? adx : ady;
+    line->sx = x1 < x2 ? 1 : -1;
+    line->sy = y1 < y2 ? 1 : -1;
+    line->k1 = 0;
+    line->k2 = line->major;
+    line->x = x1;
+    line->y = y1;
+    line->err = line->major;
+}
+
+// Clips the line from (x1, y1) to (x2, y2) to the rect left..right, top..bottom (inclusive) without walking the steps
+// that fall off it. Returns false if none of it is visible
+bool olivec_clip_line_rect(int x1, int y1, int x2, int y2, int64_t left, int64_t top, int64_t right, int64_t bottom, Olivec_Line *line)
+{
+    int64_t xmin = x1 < x2 ? x1 : x2;
+    int64_t xmax = x1 > x2 ? x1 : x2;
+    int64_t ymin = y1 < y2 ? y1 : y2;
+    int64_t ymax = y1 > y2 ? y1 : y2;
+    if (xmax < left || ymax < top || xmin > right || ymin > bottom)
+        return false;
+    olivec_line_init(x1, y1, x2, y2, line);
+    // Lines that start on the canvas start at step 0, where there is nothing to divide
+    if (left <= xmin && top <= ymin && xmax <= right && ymax <= bottom)
+        return true;
+
+    int64_t major_start = line->steep ? line->y : line->x;
+    int64_t minor_start = line->steep ? line->x : line->y;
+    int minor_dir = line->steep ? line->sx : line->sy;
+    int64_t major_min = line->steep ? top : left;
+    int64_t major_max = line->steep ? bottom : right;
+    int64_t minor_min = line->steep ? left : top;
+    int64_t minor_max = line->steep ? right : bottom;
+    if (line->k1 < major_min - major_start)
+        line->k1 = major_min - major_start;
+    if (line->k2 > major_max - major_start)
+        line->k2 = major_max - major_start;
+
+    // The range of minor steps that stays in the rect
+    int64_t lo = minor_dir > 0 ? minor_min - minor_start : minor_start - minor_max;
+    int64_t hi = minor_dir > 0 ? minor_max - minor_start : minor_start - minor_min;
+    int64_t k1 = olivec_line_first_step(lo, line->minor, line->major);
+    int64_t k2 = olivec_line_first_step(hi + 1, line->minor, line->major) - 1;
+    if (line->k1 < k1)
+        line->k1 = k1;
+    if (line->k2 > k2)
+        line->k2 = k2;
+    if (line->k1 > line->k2)
+        return false;
+
+    int64_t minor_steps = 0;
+    if (line->k1 != 0)
+        minor_steps = olivec_line_minor_steps(line->k1, line->minor, line->major, &line->err);
+    int64_t major_pos = major_start + line->k1;
+    int64_t minor_pos = minor_start + minor_dir * minor_steps;
+    line->x = line->steep ? minor_pos : major_pos;
+    line->y = line->steep ? major_pos : minor_pos;
+    return true;
+}
+
+// Clips the line from (x1, y1) to (x2, y2) to the canvas. Returns false if none of it is visible
+bool olivec_clip_line(Olivec_Canvas oc, int x1, int y1, int x2, int y2, Olivec_Line *line)
+{
+    return olivec_clip_line_rect(x1, y1, x2, y2, 0, 0, (int64_t)oc.width - 1, (int64_t)oc.height - 1, line);
+}
+
+// Defines `walk`, which plots the steps k1..k2 of a clipped line on pixels of type T, starting with `pixel` at step k1.
+// Native canvases and the ones of every other pixel format walk their lines with the same code.
+#define OLIVEC_DEFINE_WALK_LINE(walk, T)                                              \
+    void walk(T *pixel, size_t stride, const Olivec_Line *line, T color)              \
+    {                                                                                 \
+        ptrdiff_t major_step = line->steep ? (ptrdiff_t)stride : 1;                   \
+        ptrdiff_t minor_step = line->steep ? line->sx : line->sy * (ptrdiff_t)stride; \
+        int64_t err = line->err;                                                      \
+        for (int64_t k = line->k1;; ++k)                                              \
+        {                                                                             \
+            *pixel = color;                                                           \
+            if (k == line->k2)                                                        \
+                break;                                                                \
+            pixel += major_step;                                                      \
+            err += 2 * line->minor;                                                   \
+            if (err >= 2 * line->major)                                               \
+            {                                                                         \
+                err -= 2 * line->major;                                               \
+                pixel += minor_step;                                                  \
+            }                                                                         \
+        }                                                                             \
+    }
+
+OLIVEC_DEFINE_WALK_LINE(olivec_walk_line, uint32_t)
+
+// Horizontal line on the row y from x1 to x2, both inclusive, filled as one span
+void olivec_draw_hline(Olivec_Canvas oc, int y, int x1, int x2, uint32_t color)
+{
+    if (x1 > x2)
+        OLIVEC_SWAP(int, x1, x2);
+    olivec_damage_bounds(oc, x1, y, x2, y);
+    if (y < 0 || (size_t)y >= oc.height)
+        return;
+    olivec_fill_row(oc, y, x1, x2, color);
+}
+
+// How many rows ahead olivec_draw_vline() prefetches. Every row of a vertical line is on its own cache line, and on
+// wide canvases on its own page, where the hardware prefetcher does not follow it. Only GCC and Clang prefetch
+#ifndef OLIVEC_VLINE_PREFETCH
+#define OLIVEC_VLINE_PREFETCH 16
+#endif
+
+// Vertical line on the column x from y1 to y2, both inclusive, one store per row stepping by the stride
+void olivec_draw_vline(Olivec_Canvas oc, int x, int y1, int y2, uint32_t color)
+{
+    if (y1 > y2)
+        OLIVEC_SWAP(int, y1, y2);
+    olivec_damage_bounds(oc, x, y1, x, y2);
+    if (x < 0 || (size_t)x >= oc.width || y2 < 0 || (y1 >= 0 && (size_t)y1 >= oc.height))
+        return;
+    size_t top = y1 < 0 ? 0 : (size_t)y1;
+    size_t bottom = (size_t)y2 < oc.height ? (size_t)y2 : oc.height - 1;
+
+    uint32_t *pixel = &OLIVEC_PIXEL(oc, x, top);
+    for (size_t n = bottom - top + 1; n > 0; --n)
+    {
+#if defined(__GNUC__)
+        if (n > OLIVEC_VLINE_PREFETCH)
+            __builtin_prefetch(pixel + OLIVEC_VLINE_PREFETCH * oc.stride, 1);
+#endif
+        *pixel = color;
+        pixel += oc.stride;
+    }
+}
+
+// Bresenham: the line takes one step along its major axis per pixel and one step along the minor axis whenever the
+// error term wraps, so every pixel costs the same few integer adds whatever the slope. Only the steps that
+// olivec_clip_line() finds on the canvas are walked, the first of them reached in constant time. Horizontal and
+// vertical lines go to olivec_draw_hline() and olivec_draw_vline() instead.
+void olivec_draw_line(Olivec_Canvas oc, int x1, int y1, int x2, int y2, uint32_t color)
+{
+    if (y1 == y2)
+    {
+        olivec_draw_hline(oc, y1, x1, x2, color);
+        return;
+    }
+    if (x1 == x2)
+    {
+        olivec_draw_vline(oc, x1, y1, y2, color);
+        return;
+    }
+
+    olivec_damage_bounds(oc, x1, y1, x2, y2);
+
+    Olivec_Line line;
+    if (!olivec_clip_line(oc, x1, y1, x2, y2, &line))
+        return;
+
+    olivec_walk_line(&OLIVEC_PIXEL(oc, line.x, line.y), oc.stride, &line, color);
+}
+
+// A dash pattern for lines: pixel i of a line is drawn if bit (phase + i) % length of mask is set, counting pixels
+// along the major axis from the first point the line was given with. Drawing a line moves the phase past its
+// pixels, so consecutive lines and the segments of a polyline continue the pattern where the last one stopped.
+typedef struct
+{
+    uint64_t mask;
+    // Pixels per period, 1 to 64. Any other length draws every pixel, so a zero-initialized pattern is a solid line
+    unsigned length;
+    unsigned phase;
+} Olivec_Line_Pattern;
+
+// Whether `pattern` has a length the mask can hold, and with it a phase to carry from line to line
+bool olivec_pattern_periodic(const Olivec_Line_Pattern *pattern)
+{
+    return pattern->length >= 1 && pattern->length <= 64;
+}
+
+// Whether `pattern` draws every pixel of a line
+bool olivec_pattern_solid(const Olivec_Line_Pattern *pattern)
+{
+    if (!olivec_pattern_periodic(pattern))
+        return true;
+    return (pattern->mask | ~(uint64_t)0 << (pattern->length - 1) << 1) == ~(uint64_t)0;
+}
+
+// `on` pixels drawn then `off` pixels skipped. olivec_dash(1, 1) is dotted. The mask only holds 64 pixels, so longer
+// periods are scaled down to 64 keeping the ratio of on to off. olivec_dash(0, 0) is a solid line
+Olivec_Line_Pattern olivec_dash(unsigned on, unsigned off)
+{
+    Olivec_Line_Pattern pattern = {0};
+    uint64_t total = (uint64_t)on + off;
+    if (total > 64)
+    {
+        on = (unsigned)(((uint64_t)on * 64 + total / 2) / total);
+        off = 64 - on;
+    }
+    pattern.length = on + off;
+    pattern.mask = on >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << on) - 1;
+    return pattern;
+}
+
+uint64_t olivec_reverse_bits(uint64_t x)
+{
+    x = (x >> 1 & 0x5555555555555555) | (x & 0x5555555555555555) << 1;
+    x = (x >> 2 & 0x3333333333333333) | (x & 0x3333333333333333) << 2;
+    x = (x >> 4 & 0x0F0F0F0F0F0F0F0F) | (x & 0x0F0F0F0F0F0F0F0F) << 4;
+    x = (x >> 8 & 0x00FF00FF00FF00FF) | (x & 0x00FF00FF00FF00FF) << 8;
+    x = (x >> 16 & 0x0000FFFF0000FFFF) | (x & 0x0000FFFF0000FFFF) << 16;
+    return x >> 32 | x << 32;
+}
+
+// Plots the steps k1..k2 of a clipped line that are set in `pattern`, starting with `pixel` at step k1. `start` is the
+// position in the pattern of the first point the line was given with, so steps cut off by clipping are skipped in
+// the pattern too.
+void olivec_walk_line_pattern(uint32_t *pixel, size_t stride, const Olivec_Line *line, const Olivec_Line_Pattern *pattern, uint64_t start, uint32_t color)
+{
+    if (olivec_pattern_solid(pattern))
+    {
+        olivec_walk_line(pixel, stride, line, color);
+        return;
+    }
 
-#define OLIVEC_ABS(T, x) (OLIVEC_SIGN(T, x) * (x))
+    uint64_t mask = pattern->mask;
+    unsigned length = pattern->length;
+    unsigned phase;
+    // A reversed line is walked against the pattern, so it reads the mirrored mask forwards instead
+    if (line->reversed)
+    {
+        mask = olivec_reverse_bits(mask) >> (64 - length);
+        phase = length - 1 - (unsigned)((start + (uint64_t)(line->major - line->k1)) % length);
+    }
+    else
+    {
+        phase = (unsigned)((start + (uint64_t)line->k1) % length);
+    }
+
+    ptrdiff_t major_step = line->steep ? (ptrdiff_t)stride : 1;
+    ptrdiff_t minor_step = line->steep ? line->sx : line->sy * (ptrdiff_t)stride;
+    int64_t err = line->err;
+    // Pixels that are off in the pattern are written to `sink` instead, which costs less than a branch that mispredicts
+    // at every dash boundary
+    uint32_t sink;
+    for (int64_t k = line->k1;; ++k)
+    {
+        *(mask >> phase & 1 ? pixel : &sink) = color;
+        if (k == line->k2)
+            break;
+        phase = phase + 1 == length ? 0 : phase + 1;
+        pixel += major_step;
+        err += 2 * line->minor;
+        if (err >= 2 * line->major)
+        {
+            err -= 2 * line->major;
+            pixel += minor_step;
+        }
+    }
+}
 
-void olivec_fill(uint32_t *pixels, size_t width, size_t height, uint32_t color)
+// olivec_draw_line() with only the pixels set in `pattern` drawn. Moves the phase of the pattern past the line.
+void olivec_draw_line_pattern(Olivec_Canvas oc, int x1, int y1, int x2, int y2, Olivec_Line_Pattern *pattern, uint32_t color)
 {
-    for (size_t i = 0; i < width * height; ++i)
+    // Without a valid length there is no phase to carry and nothing to wrap it at
+    if (!olivec_pattern_periodic(pattern))
     {
-        pixels[i] = color;
+        olivec_draw_line(oc, x1, y1, x2, y2, color);
+        return;
     }
+
+    olivec_damage_bounds(oc, x1, y1, x2, y2);
+
+    Olivec_Line line;
+    if (olivec_clip_line(oc, x1, y1, x2, y2, &line))
+        olivec_walk_line_pattern(&OLIVEC_PIXEL(oc, line.x, line.y), oc.stride, &line, pattern, pattern->phase, color);
+
+    int64_t dx = x2 > x1 ? (int64_t)x2 - x1 : (int64_t)x1 - x2;
+    int64_t dy = y2 > y1 ? (int64_t)y2 - y1 : (int64_t)y1 - y2;
+    uint64_t pixels = (uint64_t)(dx > dy ? dx : dy) + 1;
+    pattern->phase = (unsigned)((pattern->phase + pixels) % pattern->length);
 }
 
-void olivec_fill_rect(uint32_t *pixels, size_t pixels_width, size_t pixels_height, int x1, int y1, int w, int h, uint32_t color)
+// Xiaolin Wu: every step along the major axis splits the color between the two pixels the exact line passes between,
+// in proportion to its distance from each. The distance is the remainder of k*minor / major, stepped exactly with
+// integer adds, so long lines do not drift. Both endpoints are on pixel centers and drawn at full coverage.
+void olivec_draw_line_aa(Olivec_Canvas oc, int x1, int y1, int x2, int y2, uint32_t color)
 {
-    int x2 = x1 + OLIVEC_SIGN(int, w) * (OLIVEC_ABS(int, w) - 1);
-    if (x1 > x2)
-        OLIVEC_SWAP(int, x1, x2);
+    olivec_damage_bounds(oc, x1, y1, x2, y2);
 
-    int y2 = y1 + OLIVEC_SIGN(int, h) * (OLIVEC_ABS(int, h) - 1);
-    if (y1 > y2)
-        OLIVEC_SWAP(int, y1, y2);
+    Olivec_Clip clip = olivec_clip_bounds(oc, x1 < x2 ? x1 : x2, y1 < y2 ? y1 : y2, x1 > x2 ? x1 : x2, y1 > y2 ? y1 : y2);
+    if (clip == OLIVEC_OUTSIDE)
+        return;
+
+    // The two pixels of a step are at most one pixel either side of the Bresenham one, so clipping to the canvas grown
+    // by a pixel keeps every step with a visible pixel
+    Olivec_Line line;
+    if (!olivec_clip_line_rect(x1, y1, x2, y2, -1, -1, (int64_t)oc.width, (int64_t)oc.height, &line))
+        return;
+
+    // The Bresenham error term 2*k*minor + major modulo 2*major gives the pixel q below the exact line and the
+    // remainder r of k*minor / major, the distance past q in units of 1/major
+    int minor_dir = line.steep ? line.sx : line.sy;
+    int64_t major_pos = line.steep ? line.y : line.x;
+    int64_t minor_pos = line.steep ? line.x : line.y;
+    int64_t r = (line.err - line.major) / 2;
+    if (line.err < line.major)
+    {
+        minor_pos -= minor_dir;
+        r += line.major;
+    }
 
-    for (int y = y1; y <= y2; ++y)
+    uint32_t alpha = OLIVEC_ALPHA(color);
+    uint32_t rgb = color & 0x00FFFFFF;
+    // The alpha of the far pixel is r * alpha / major, in 32.32 fixed point
+    uint64_t alpha_step = line.major != 0 ? ((uint64_t)alpha << 32) / (uint64_t)line.major : 0;
+
+    if (clip == OLIVEC_INSIDE)
     {
-        if (0 <= y && y < (int)pixels_height)
+        ptrdiff_t major_step = line.steep ? (ptrdiff_t)oc.stride : 1;
+        ptrdiff_t minor_step = line.steep ? minor_dir : minor_dir * (ptrdiff_t)oc.stride;
+        uint32_t *pixel = line.steep ? &OLIVEC_PIXEL(oc, minor_pos, major_pos) : &OLIVEC_PIXEL(oc, major_pos, minor_pos);
+        for (int64_t k = line.k1;; ++k)
         {
-            for (int x = x1; x <= x2; ++x)
+            // Without coverage the far pixel can be past the end of the line and off the canvas
+            uint32_t far = (uint32_t)(((uint64_t)r * alpha_step) >> 32);
+            if (far == 0)
+                olivec_blend_color(pixel, color);
+            else
+                olivec_blend_color_pair(pixel, pixel + minor_step, color, alpha - far, far);
+            if (k == line.k2)
+                break;
+
+            pixel += major_step;
+            r += line.minor;
+            if (r >= line.major)
             {
-                if (0 <= x && x < (int)pixels_width)
-                {
-                    pixels[y * pixels_width + x] = color;
-                }
+                r -= line.major;
+                pixel += minor_step;
             }
         }
+        return;
+    }
+
+    for (int64_t k = line.k1; k <= line.k2; ++k)
+    {
+        uint32_t far = (uint32_t)(((uint64_t)r * alpha_step) >> 32);
+        uint32_t near = alpha - far;
+        int64_t x = line.steep ? minor_pos : major_pos;
+        int64_t y = line.steep ? major_pos : minor_pos;
+        int64_t fx = line.steep ? minor_pos + minor_dir : major_pos;
+        int64_t fy = line.steep ? major_pos : minor_pos + minor_dir;
+        if (near != 0 && 0 <= x && x < (int64_t)oc.width && 0 <= y && y < (int64_t)oc.height)
+            olivec_blend_color(&OLIVEC_PIXEL(oc, x, y), rgb | (near << (8 * 3)));
+        if (far != 0 && 0 <= fx && fx < (int64_t)oc.width && 0 <= fy && fy < (int64_t)oc.height)
+            olivec_blend_color(&OLIVEC_PIXEL(oc, fx, fy), rgb | (far << (8 * 3)));
+
+        major_pos += 1;
+        r += line.minor;
+        if (r >= line.major)
+        {
+            r -= line.major;
+            minor_pos += minor_dir;
+        }
     }
 }
 
-void olivec_fill_circle(uint32_t *pixels, size_t pixels_width, size_t pixels_height, int cx, int cy, int r, uint32_t color)
+typedef struct
 {
-    if (r == 0)
-        return;
+    int x;
+    int y;
+} Olivec_Point;
 
-    int x1 = cx - r;
-    int x2 = cx + r;
-    if (x1 > x2)
-        OLIVEC_SWAP(int, x1, x2);
+typedef enum
+{
+    OLIVEC_CAP_BUTT = 0,
+    OLIVEC_CAP_ROUND,
+    OLIVEC_CAP_SQUARE,
+} Olivec_Cap;
 
-    int y1 = cy - r;
-    int y2 = cy + r;
-    if (y1 > y2)
-        OLIVEC_SWAP(int, y1, y2);
+typedef enum
+{
+    OLIVEC_JOIN_MITER = 0,
+    OLIVEC_JOIN_ROUND,
+    OLIVEC_JOIN_BEVEL,
+} Olivec_Join;
+
+// Miter joins whose tip is further than this many stroke widths from the inner corner are beveled instead, as in SVG
+#ifndef OLIVEC_MITER_LIMIT
+#define OLIVEC_MITER_LIMIT 4.0
+#endif
+
+// Without an allocator strokes are built in batches of this many pieces on the stack
+#ifndef OLIVEC_STROKE_BATCH
+#define OLIVEC_STROKE_BATCH 64
+#endif
+
+// A stroke is the union of convex pieces: the body of every segment with its square caps, and a polygon or a disc for
+// every join and round cap. Pixels are sampled at their integer coordinates, the centers of the thin line.
+typedef struct
+{
+    // Bounds of the pixels the piece can cover, inclusive
+    int64_t left;
+    int64_t top;
+    int64_t right;
+    int64_t bottom;
+    // A disc of this diameter around (cx, cy) if it is not 0, otherwise the convex polygon xs, ys
+    int64_t diameter;
+    int64_t cx;
+    int64_t cy;
+    int count;
+    double xs[4];
+    double ys[4];
+} Olivec_Stroke_Piece;
+
+void olivec_stroke_disc(Olivec_Stroke_Piece *piece, int64_t cx, int64_t cy, int64_t diameter)
+{
+    piece->diameter = diameter;
+    piece->cx = cx;
+    piece->cy = cy;
+    piece->left = cx - diameter / 2 - 1;
+    piece->top = cy - diameter / 2 - 1;
+    piece->right = cx + diameter / 2 + 1;
+    piece->bottom = cy + diameter / 2 + 1;
+}
+
+// Sets the polygon of a piece to the `count` points (xs[i], ys[i]) listed in order around it
+void olivec_stroke_polygon(Olivec_Stroke_Piece *piece, int count, const double *xs, const double *ys)
+{
+    piece->diameter = 0;
+    piece->count = count;
+    double left = xs[0], top = ys[0], right = xs[0], bottom = ys[0];
+    for (int i = 0; i < count; ++i)
+    {
+        piece->xs[i] = xs[i];
+        piece->ys[i] = ys[i];
+        left = xs[i] < left ? xs[i] : left;
+        top = ys[i] < top ? ys[i] : top;
+        right = xs[i] > right ? xs[i] : right;
+        bottom = ys[i] > bottom ? ys[i] : bottom;
+    }
+    piece->left = (int64_t)left - 1;
+    piece->top = (int64_t)top - 1;
+    piece->right = (int64_t)right + 1;
+    piece->bottom = (int64_t)bottom + 1;
+}
+
+// Sets the pixels of the row y that the piece covers. Polygon edges are half-open to the right and the bottom, and so
+// is the boundary of a disc: of the pixels exactly on it, only the ones left of or above the center are covered.
+// That keeps a stroke of width w exactly w pixels thick along either axis.
+bool olivec_stroke_piece_span(const Olivec_Stroke_Piece *piece, int64_t y, Olivec_Span *span)
+{
+    if (y < piece->top || y > piece->bottom)
+        return false;
+
+    if (piece->diameter != 0)
+    {
+        // The pixels with 4*(dx*dx + dy*dy) < diameter^2
+        int64_t dy = y - piece->cy;
+        int64_t rr = piece->diameter * piece->diameter - 4 * dy * dy;
+        if (rr < 0)
+            return false;
+        int64_t w = rr > 0 ? (int64_t)olivec_isqrt((uint64_t)(rr - 1)) / 2 : -1;
+        span->x1 = -w;
+        span->x2 = w;
+        int64_t s = (int64_t)olivec_isqrt((uint64_t)rr);
+        if (s * s == rr && s % 2 == 0)
+        {
+            if (dy < 0)
+                span->x2 = s / 2;
+            if (dy <= 0)
+                span->x1 = -s / 2;
+        }
+        if (span->x1 > span->x2)
+            return false;
+        span->x1 += piece->cx;
+        span->x2 += piece->cx;
+        return true;
+    }
+
+    double sy = (double)y;
+    double x1 = 0, x2 = 0;
+    bool crossed = false;
+    for (int i = 0; i < piece->count; ++i)
+    {
+        int j = i + 1 < piece->count ? i + 1 : 0;
+        double ya = piece->ys[i];
+        double yb = piece->ys[j];
+        if ((ya <= sy && sy < yb) || (yb <= sy && sy < ya))
+        {
+            double x = piece->xs[i] + (sy - ya) * (piece->xs[j] - piece->xs[i]) / (yb - ya);
+            if (!crossed || x < x1)
+                x1 = x;
+            if (!crossed || x > x2)
+                x2 = x;
+            crossed = true;
+        }
+    }
+    if (!crossed)
+        return false;
+
+    // The pixels with x1 <= x < x2, the polygon bounds keep the conversions in range
+    x1 = x1 < (double)piece->left ? (double)piece->left : x1;
+    x2 = x2 > (double)piece->right ? (double)piece->right : x2;
+    span->x1 = (int64_t)x1;
+    if ((double)span->x1 < x1)
+        span->x1 += 1;
+    span->x2 = (int64_t)x2;
+    if ((double)span->x2 >= x2)
+        span->x2 -= 1;
+    return span->x1 <= span->x2;
+}
+
+// Writes the pieces of the vertex i of a stroke into `pieces` and returns how many there are, at most 2: the cap or
+// join there and the body of the segment that starts there. Repeated points are skipped.
+size_t olivec_stroke_vertex(const Olivec_Point *points, size_t count, size_t i, int width, Olivec_Cap cap, Olivec_Join join, Olivec_Stroke_Piece *pieces)
+{
+    Olivec_Point v = points[i];
+    if (i > 0 && points[i - 1].x == v.x && points[i - 1].y == v.y)
+        return 0;
+
+    size_t next = i + 1;
+    while (next < count && points[next].x == v.x && points[next].y == v.y)
+        next += 1;
+    bool has_prev = i > 0;
+    bool has_next = next < count;
+    double h = width / 2.0;
+    size_t n = 0;
 
-    for (int y = y1; y <= y2; ++y)
+    if (!has_prev && !has_next)
     {
-        if (0 <= y && y < (int)pixels_height)
+        if (cap == OLIVEC_CAP_ROUND)
         {
-            for (int x = x1; x <= x2; ++x)
+            olivec_stroke_disc(&pieces[n++], v.x, v.y, width);
+        }
+        else if (cap == OLIVEC_CAP_SQUARE)
+        {
+            double xs[4] = {v.x - h, v.x + h, v.x + h, v.x - h};
+            double ys[4] = {v.y - h, v.y - h, v.y + h, v.y + h};
+            olivec_stroke_polygon(&pieces[n++], 4, xs, ys);
+        }
+        return n;
+    }
+
+    if (!has_prev || !has_next)
+    {
+        if (cap == OLIVEC_CAP_ROUND)
+            olivec_stroke_disc(&pieces[n++], v.x, v.y, width);
+    }
+    else
+    {
+        // The join between the segments a, that ends at v, and b, that starts there, on the outer side of the turn
+        Olivec_Point a = points[i - 1];
+        Olivec_Point b = points[next];
+        double adx = (double)v.x - a.x, ady = (double)v.y - a.y;
+        double bdx = (double)b.x - v.x, bdy = (double)b.y - v.y;
+        double alen = olivec_sqrt(adx * adx + ady * ady);
+        double blen = olivec_sqrt(bdx * bdx + bdy * bdy);
+        // Unit normals
+        double anx = -ady / alen, any = adx / alen;
+        double bnx = -bdy / blen, bny = bdx / blen;
+        double turn = anx * bdx + any * bdy;
+        if (join == OLIVEC_JOIN_ROUND)
+        {
+            olivec_stroke_disc(&pieces[n++], v.x, v.y, width);
+        }
+        else if (turn != 0)
+        {
+            double side = turn > 0 ? -h : h;
+            double c = anx * bnx + any * bny;
+            if (join == OLIVEC_JOIN_MITER && 1 + c >= 2 / (OLIVEC_MITER_LIMIT * OLIVEC_MITER_LIMIT))
             {
-                if (0 <= x && x < (int)pixels_width)
-                {
-                    int dx = x - cx;
-                    int dy = y - cy;
-                    if (dx * dx + dy * dy <= r * r)
-                    {
-                        pixels[y * pixels_width + x] = color;
-                    }
-                }
+                double xs[4] = {v.x, v.x + side * anx, v.x + side * (anx + bnx) / (1 + c), v.x + side * bnx};
+                double ys[4] = {v.y, v.y + side * any, v.y + side * (any + bny) / (1 + c), v.y + side * bny};
+                olivec_stroke_polygon(&pieces[n++], 4, xs, ys);
             }
+            else
+            {
+                double xs[3] = {v.x, v.x + side * anx, v.x + side * bnx};
+                double ys[3] = {v.y, v.y + side * any, v.y + side * bny};
+                olivec_stroke_polygon(&pieces[n++], 3, xs, ys);
+            }
+        }
+    }
+
+    if (has_next)
+    {
+        Olivec_Point b = points[next];
+        size_t last = next + 1;
+        while (last < count && points[last].x == b.x && points[last].y == b.y)
+            last += 1;
+
+        double dx = (double)b.x - v.x, dy = (double)b.y - v.y;
+        double len = olivec_sqrt(dx * dx + dy * dy);
+        double tx = dx / len * h, ty = dy / len * h;
+        double x1 = v.x, y1 = v.y, x2 = b.x, y2 = b.y;
+        if (cap == OLIVEC_CAP_SQUARE && !has_prev)
+        {
+            x1 -= tx;
+            y1 -= ty;
         }
+        if (cap == OLIVEC_CAP_SQUARE && last == count)
+        {
+            x2 += tx;
+            y2 += ty;
+        }
+        double xs[4] = {x1 - ty, x2 - ty, x2 + ty, x1 + ty};
+        double ys[4] = {y1 + tx, y2 + tx, y2 - tx, y1 - tx};
+        olivec_stroke_polygon(&pieces[n++], 4, xs, ys);
     }
+    return n;
 }
 
-void olivec_draw_line(uint32_t *pixels, size_t pixels_width,
-                      size_t pixels_height, int x1, int y1, int x2, int y2,
-                      uint32_t color)
+void olivec_sift_span(Olivec_Span *spans, size_t root, size_t count)
 {
-    // Objective is to get the values of k and c, where k represents the slope and c is the y-intercept.
-    // y = k*x + c
-    // y1 = k*x1 + c -(i)
-    // y2 = k*x2 + c -(ii)
-    // c = y1 - k*x1 -(iii)
+    for (size_t child = 2 * root + 1; child < count; child = 2 * root + 1)
+    {
+        if (child + 1 < count && spans[child + 1].x1 > spans[child].x1)
+            child += 1;
+        if (spans[root].x1 >= spans[child].x1)
+            return;
+        OLIVEC_SWAP(Olivec_Span, spans[root], spans[child]);
+        root = child;
+    }
+}
 
-    // After Substituting (iii) in (ii)
-    // y2 = k*x2 + y1 - k*x1
-    // y2 = k*(x2 - x1) + y1
-    // y2 - y1 = k*(x2 - x1)
-    // k = (y2 - y1)/(x2 - x1)
+// Sorts spans by their left end. A row of a long stroke can cross thousands of pieces in any order, so this is a
+// heap sort rather than an insertion sort.
+void olivec_sort_spans(Olivec_Span *spans, size_t count)
+{
+    for (size_t i = count / 2; i > 0; --i)
+        olivec_sift_span(spans, i - 1, count);
+    for (size_t end = count; end > 1; --end)
+    {
+        OLIVEC_SWAP(Olivec_Span, spans[0], spans[end - 1]);
+        olivec_sift_span(spans, 0, end - 1);
+    }
+}
 
-    // c = y1 - k*x1
-    // k = (y2 - y1)/(x2 - x1)
+// Fills the union of the pieces of a stroke. Every row gathers the spans of the pieces that cross it and merges the
+// ones that overlap or touch, so each pixel is written once however many pieces cover it. `band` and `spans` are
+// scratch space for `count` entries each.
+void olivec_fill_stroke_pieces(Olivec_Canvas oc, const Olivec_Stroke_Piece *pieces, size_t count, size_t *band, Olivec_Span *spans, uint32_t color)
+{
+    if (count == 0)
+        return;
 
-    int dx = x2 - x1;
-    int dy = y2 - y1;
+    int64_t left = pieces[0].left, top = pieces[0].top, right = pieces[0].right, bottom = pieces[0].bottom;
+    for (size_t i = 1; i < count; ++i)
+    {
+        left = pieces[i].left < left ? pieces[i].left : left;
+        top = pieces[i].top < top ? pieces[i].top : top;
+        right = pieces[i].right > right ? pieces[i].right : right;
+        bottom = pieces[i].bottom > bottom ? pieces[i].bottom : bottom;
+    }
+    if (olivec_clip_bounds(oc, left, top, right, bottom) == OLIVEC_OUTSIDE)
+        return;
+    left = left < 0 ? 0 : left;
+    top = top < 0 ? 0 : top;
+    right = right >= (int64_t)oc.width ? (int64_t)oc.width - 1 : right;
+    bottom = bottom >= (int64_t)oc.height ? (int64_t)oc.height - 1 : bottom;
+    olivec_damage_bounds(oc, left, top, right, bottom);
 
-    if (dx != 0)
+    // Only the pieces that overlap a band of rows are visited for the rows of that band
+    for (int64_t band_y1 = top; band_y1 <= bottom; band_y1 += OLIVEC_BAND_HEIGHT)
     {
-        int c = y1 - dy * x1 / dx;
+        int64_t band_y2 = band_y1 + OLIVEC_BAND_HEIGHT - 1 < bottom ? band_y1 + OLIVEC_BAND_HEIGHT - 1 : bottom;
+        size_t band_count = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (pieces[i].top <= band_y2 && pieces[i].bottom >= band_y1 && pieces[i].right >= 0 && pieces[i].left < (int64_t)oc.width)
+                band[band_count++] = i;
+        }
 
-        if (x1 > x2)
-            OLIVEC_SWAP(int, x1, x2);
-        for (int x = x1; x <= x2; ++x)
+        for (int64_t y = band_y1; y <= band_y2; ++y)
         {
-            if (0 <= x && x < (int)pixels_width)
+            size_t span_count = 0;
+            for (size_t i = 0; i < band_count; ++i)
             {
-                int sy1 = dy * x / dx + c;
-                int sy2 = dy * (x + 1) / dx + c;
-                if (sy1 > sy2)
-                    OLIVEC_SWAP(int, sy1, sy2);
-                for (int y = sy1; y <= sy2; y++)
+                if (olivec_stroke_piece_span(&pieces[band[i]], y, &spans[span_count]))
+                    span_count += 1;
+            }
+            if (span_count == 0)
+                continue;
+
+            olivec_sort_spans(spans, span_count);
+            Olivec_Span run = spans[0];
+            for (size_t i = 1; i < span_count; ++i)
+            {
+                if (spans[i].x1 <= run.x2 + 1)
                 {
-                    if (0 <= y && y < (int)pixels_height)
-                    {
-                        pixels[y * pixels_width + x] = color;
-                    }
+                    run.x2 = spans[i].x2 > run.x2 ? spans[i].x2 : run.x2;
+                    continue;
                 }
+                olivec_fill_row(oc, (int)y, run.x1, run.x2, color);
+                run = spans[i];
             }
+            olivec_fill_row(oc, (int)y, run.x1, run.x2, color);
+        }
+    }
+}
+
+// Strokes the polyline through `count` points with a line `width` pixels wide, ending in `cap` at both ends and
+// turning the corners with `join`. The stroke is filled as the union of its pieces, so every pixel is written once.
+void olivec_stroke_polyline(Olivec_Canvas oc, const Olivec_Point *points, size_t count, int width, Olivec_Cap cap, Olivec_Join join, uint32_t color)
+{
+    if (count == 0 || width <= 0)
+        return;
+
+#ifndef OLIVEC_FREESTANDING
+    Olivec_Stroke_Piece *pieces = malloc(2 * count * sizeof(*pieces));
+    size_t *band = malloc(2 * count * sizeof(*band));
+    Olivec_Span *spans = malloc(2 * count * sizeof(*spans));
+    if (pieces != NULL && band != NULL && spans != NULL)
+    {
+        size_t n = 0;
+        for (size_t i = 0; i < count; ++i)
+            n += olivec_stroke_vertex(points, count, i, width, cap, join, &pieces[n]);
+        olivec_fill_stroke_pieces(oc, pieces, n, band, spans, color);
+        free(pieces);
+        free(band);
+        free(spans);
+        return;
+    }
+    free(pieces);
+    free(band);
+    free(spans);
+#endif
+
+    // Without an allocator the stroke is filled in batches, and only pixels where two batches overlap are written twice
+    Olivec_Stroke_Piece batch[OLIVEC_STROKE_BATCH];
+    size_t batch_band[OLIVEC_STROKE_BATCH];
+    Olivec_Span batch_spans[OLIVEC_STROKE_BATCH];
+    size_t n = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (n + 2 > OLIVEC_STROKE_BATCH)
+        {
+            olivec_fill_stroke_pieces(oc, batch, n, batch_band, batch_spans, color);
+            n = 0;
         }
+        n += olivec_stroke_vertex(points, count, i, width, cap, join, &batch[n]);
+    }
+    olivec_fill_stroke_pieces(oc, batch, n, batch_band, batch_spans, color);
+}
+
+// A line `width` pixels wide from (x1, y1) to (x2, y2), see olivec_stroke_polyline()
+void olivec_draw_thick_line(Olivec_Canvas oc, int x1, int y1, int x2, int y2, int width, Olivec_Cap cap, uint32_t color)
+{
+    Olivec_Point points[2] = {{x1, y1}, {x2, y2}};
+    olivec_stroke_polyline(oc, points, 2, width, cap, OLIVEC_JOIN_MITER, color);
+}
+
+// Cohen-Sutherland outcode of a point: one bit for each side of the rect it is beyond. A segment whose endpoints
+// share a bit is entirely off that side.
+int olivec_outcode(int64_t x, int64_t y, int64_t left, int64_t top, int64_t right, int64_t bottom)
+{
+    return (x < left) | (x > right) << 1 | (y < top) << 2 | (y > bottom) << 3;
+}
+
+// Moves a clipped line one step forward, dropping step k1
+void olivec_line_skip_first(Olivec_Line *line)
+{
+    line->k1 += 1;
+    line->err += 2 * line->minor;
+    bool carry = line->err >= 2 * line->major;
+    if (carry)
+        line->err -= 2 * line->major;
+    if (line->steep)
+    {
+        line->y += 1;
+        line->x += carry ? line->sx : 0;
     }
     else
     {
-        int x = x1;
-        if (0 <= x && x < (int)pixels_width)
+        line->x += 1;
+        line->y += carry ? line->sy : 0;
+    }
+}
+
+typedef struct
+{
+    Olivec_Canvas oc;
+    const Olivec_Point *points;
+    size_t count;
+    // NULL for a solid line
+    const Olivec_Line_Pattern *pattern;
+    uint32_t color;
+} Olivec_Polyline;
+
+// Draws the rows [begin, end) of a polyline. Every segment is clipped to the band, so bands split across threads
+// write exactly the pixels the whole strip would.
+void olivec_draw_polyline_job(void *ctx, size_t begin, size_t end)
+{
+    Olivec_Polyline *pl = ctx;
+    Olivec_Canvas oc = pl->oc;
+    int64_t left = 0;
+    int64_t top = (int64_t)begin;
+    int64_t right = (int64_t)oc.width - 1;
+    int64_t bottom = (int64_t)end - 1;
+
+    // Once a segment has been drawn, the next one starts on its last pixel and skips it
+    bool joined = false;
+    // Position in the pattern of the current segment's first point
+    uint64_t start = pl->pattern != NULL ? pl->pattern->phase : 0;
+    Olivec_Point p = pl->points[0];
+    int code = olivec_outcode(p.x, p.y, left, top, right, bottom);
+    for (size_t i = 1; i < pl->count; ++i)
+    {
+        Olivec_Point q = pl->points[i];
+        int next = olivec_outcode(q.x, q.y, left, top, right, bottom);
+        if (p.x == q.x && p.y == q.y)
+            continue;
+
+        // Segments with both ends in the band need no clipping, segments with both ends off the same side are not drawn
+        Olivec_Line line;
+        bool visible = false;
+        if ((code | next) == 0)
         {
-            if (y1 > y2)
-                OLIVEC_SWAP(int, y1, y2);
-            for (int y = y1; y <= y2; ++y)
-            {
-                if (0 <= y && y < (int)pixels_height)
-                {
-                    pixels[y * pixels_width + x] = color;
-                }
-            }
+            olivec_line_init(p.x, p.y, q.x, q.y, &line);
+            visible = true;
+        }
+        else if ((code & next) == 0)
+        {
+            visible = olivec_clip_line_rect(p.x, p.y, q.x, q.y, left, top, right, bottom, &line);
+        }
+        if (visible)
+        {
+            if (joined && !line.reversed && line.k1 == 0)
+                olivec_line_skip_first(&line);
+            if (joined && line.reversed && line.k2 == line.major)
+                line.k2 -= 1;
+            if (line.k1 <= line.k2 && pl->pattern != NULL)
+                olivec_walk_line_pattern(&OLIVEC_PIXEL(oc, line.x, line.y), oc.stride, &line, pl->pattern, start, pl->color);
+            else if (line.k1 <= line.k2)
+                olivec_walk_line(&OLIVEC_PIXEL(oc, line.x, line.y), oc.stride, &line, pl->color);
+        }
+        if (pl->pattern != NULL)
+        {
+            int64_t dx = q.x > p.x ? (int64_t)q.x - p.x : (int64_t)p.x - q.x;
+            int64_t dy = q.y > p.y ? (int64_t)q.y - p.y : (int64_t)p.y - q.y;
+            start += (uint64_t)(dx > dy ? dx : dy);
         }
+        joined = true;
+        p = q;
+        code = next;
+    }
+
+    // A strip that never moves is a single point
+    bool set = pl->pattern == NULL || (pl->pattern->mask >> (start % pl->pattern->length) & 1);
+    if (!joined && code == 0 && set)
+        OLIVEC_PIXEL(oc, p.x, p.y) = pl->color;
+}
+
+// Draws the line strip through `count` points with only the pixels set in `pattern` drawn, or all of them if it is
+// NULL. The pattern runs on across the segments and its phase is moved past the whole strip, counting every shared
+// vertex once. Otherwise the same as olivec_draw_polyline()
+void olivec_draw_polyline_pattern(Olivec_Canvas oc, const Olivec_Point *points, size_t count, Olivec_Line_Pattern *pattern, uint32_t color)
+{
+    if (count == 0)
+        return;
+    if (pattern != NULL && !olivec_pattern_periodic(pattern))
+        pattern = NULL;
+
+    int64_t left = points[0].x, top = points[0].y, right = points[0].x, bottom = points[0].y;
+    // Pixels drawn, a segment is never more than the canvas width plus height on it
+    size_t cost = 0;
+    int64_t longest = (int64_t)oc.width + (int64_t)oc.height;
+    // Pixels along the whole strip
+    uint64_t length = 1;
+    for (size_t i = 1; i < count; ++i)
+    {
+        int64_t x = points[i].x;
+        int64_t y = points[i].y;
+        left = x < left ? x : left;
+        right = x > right ? x : right;
+        top = y < top ? y : top;
+        bottom = y > bottom ? y : bottom;
+
+        int64_t dx = x > points[i - 1].x ? x - points[i - 1].x : points[i - 1].x - x;
+        int64_t dy = y > points[i - 1].y ? y - points[i - 1].y : points[i - 1].y - y;
+        int64_t major = dx > dy ? dx : dy;
+        cost += (size_t)(major < longest ? major : longest);
+        length += (uint64_t)major;
+    }
+
+    if (olivec_clip_bounds(oc, left, top, right, bottom) != OLIVEC_OUTSIDE)
+    {
+        olivec_damage_bounds(oc, left, top, right, bottom);
+        Olivec_Polyline pl = {oc, points, count, pattern, color};
+        olivec_parallel_for(oc.height, cost, olivec_draw_polyline_job, &pl);
     }
+    if (pattern != NULL)
+        pattern->phase = (unsigned)((pattern->phase + length) % pattern->length);
+}
+
+// Draws the line strip through `count` points, the same pixels as olivec_draw_line() on each pair of consecutive
+// points, but every shared vertex is plotted once and each vertex is classified against the canvas once for the two
+// segments that meet there. Strips that touch many pixels are split across the thread pool by bands of rows.
+void olivec_draw_polyline(Olivec_Canvas oc, const Olivec_Point *points, size_t count, uint32_t color)
+{
+    olivec_draw_polyline_pattern(oc, points, count, NULL, color);
 }
 
 void olivec_sort_triangle_points_by_y(int *x1, int *y1, int *x2, int *y2, int *x3, int *y3)
@@ -169,73 +3327,387 @@ void olivec_sort_triangle_points_by_y(int *x1, int *y1, int *x2, int *y2, int *x
     }
 }
 
-void olivec_fill_triangle(uint32_t *pixels, size_t width, size_t height, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color)
+// One edge of a triangle being rasterized, as the edge function E(x, y) = a*x + b*y + c: the cross product of the edge
+// with the vector from its start to (x, y), positive on the inside of the triangle. A pixel counts as inside when
+// E >= bias, where bias is 0 on top and left edges and 1 on the others, so the pixels exactly on an edge shared by two
+// triangles belong to one of them.
+//
+// On a row, E - bias = a*x + row. Left edges (a > 0) let in the pixels from -floor(row / a) on and right edges (a < 0)
+// the pixels up to floor(row / -a). That quotient and its remainder are what the edge keeps, and going down a row adds
+// b to `row`, so they are stepped by the quotient and remainder of b instead of dividing again.
+typedef struct
 {
-    olivec_sort_triangle_points_by_y(&x1, &y1, &x2, &y2, &x3, &y3);
+    // floor(row / d) and row mod d on the current row, where d = |a|
+    int64_t u;
+    int64_t r;
+    int64_t d;
+    // floor(b / d) and b mod d
+    int64_t q;
+    int64_t m;
+} Olivec_Edge;
 
-    int dx12 = x2 - x1;
-    int dy12 = y2 - y1;
-    int dx13 = x3 - x1;
-    int dy13 = y3 - y1;
+// A triangle walked one row at a time from the top of its bounding box, which is clipped to the canvas once. It has
+// at most two left and two right edges; the missing ones are filled in with edges that never cut a row, so every row
+// does the same work. Horizontal edges only decide whether the last row is in, which is settled in `bottom`.
+typedef struct
+{
+    Olivec_Edge lefts[2];
+    Olivec_Edge rights[2];
+    int64_t left;
+    int64_t right;
+    int64_t y;
+    int64_t bottom;
+} Olivec_Triangle;
 
-    for (int y = y1; y <= y2; ++y)
-    {
-        if (0 <= y && (size_t)y < height)
-        {
-            // k = (y2 - y1)/(x2 - x1)
-            // c = y - k*x
+// An edge is set up at most this far out, which keeps stepping it down the rows of any canvas of fewer than 2^29 rows
+// within an int64_t, and still off the canvas if it started off it
+#define OLIVEC_EDGE_FAR ((int64_t)1 << 62)
+
+// q*k clamped to +-OLIVEC_EDGE_FAR
+int64_t olivec_edge_far_mul(int64_t q, int64_t k)
+{
+    int64_t limit = OLIVEC_EDGE_FAR / (q < 0 ? -q : q != 0 ? q : 1);
+    if (k > limit || k < -limit)
+        return (q < 0) != (k < 0) ? -OLIVEC_EDGE_FAR : OLIVEC_EDGE_FAR;
+    return q * k;
+}
 
-            // y = k*x + c
-            // x = (y - c) / k
-            // x = (y - c) / dy/dx
-            // x = (y - c) * dx/dy
-            int s1 = dy12 != 0 ? (y - y1) * dx12 / dy12 + x1 : x1;
-            int s2 = dy13 != 0 ? (y - y1) * dx13 / dy13 + x1 : x1;
+// Adds the edge from (ax, ay) to (bx, by) to the triangle, starting at row `t->y`
+void olivec_triangle_edge(Olivec_Triangle *t, int *lefts, int *rights, int ax, int ay, int bx, int by)
+{
+    int64_t a = (int64_t)ay - by;
+    int64_t b = (int64_t)bx - ax;
+    if (a == 0)
+    {
+        // A bottom edge leaves out its own row, a top edge lets in everything below it
+        if (b < 0 && t->bottom >= ay)
+            t->bottom = (int64_t)ay - 1;
+        return;
+    }
 
-            if (s1 > s2)
-                OLIVEC_SWAP(int, s1, s2);
+    // E increases to the right on left edges
+    int64_t bias = a > 0 ? 0 : 1;
+    Olivec_Edge *edge = a > 0 ? &t->lefts[(*lefts)++] : &t->rights[(*rights)++];
+    edge->d = a > 0 ? a : -a;
+    edge->q = olivec_div_floor(b, edge->d);
+    edge->m = b - edge->q * edge->d;
 
-            for (int x = s1; x <= s2; ++x)
-            {
-                if (0 <= x && (size_t)x < width)
-                {
-                    pixels[y * width + x] = color;
-                }
-            }
-        }
+    // row = b*k - a*ax - bias with k = t->y - ay needs up to 66 bits for vertices anywhere in the int range, so
+    // floor(row / d) is taken apart: a*ax is a multiple of d, b*k = q*d*k + m*k, and m*k = m*d*floor(k / d) +
+    // m*(k mod d), where the last product is below d*d and fits a uint64_t. Only q*k can be out of range, and an edge
+    // that far out is clamped to OLIVEC_EDGE_FAR.
+    int64_t k = t->y - ay;
+    int64_t kq = olivec_div_floor(k, edge->d);
+    uint64_t rest = (uint64_t)edge->m * (uint64_t)(k - kq * edge->d);
+    int64_t u = -1;
+    edge->r = edge->d - 1;
+    if (rest >= (uint64_t)bias)
+    {
+        u = (int64_t)((rest - (uint64_t)bias) / (uint64_t)edge->d);
+        edge->r = (int64_t)((rest - (uint64_t)bias) % (uint64_t)edge->d);
     }
+    edge->u = olivec_edge_far_mul(edge->q, k) + edge->m * kq + u - (a > 0 ? ax : -(int64_t)ax);
+}
 
-    int dx32 = x2 - x3;
-    int dy32 = y2 - y3;
-    int dx31 = x1 - x3;
-    int dy31 = y1 - y3;
+// The sign of a*b - c*d for factors below 2^32 in magnitude, whose products can overflow an int64_t but not a uint64_t
+int olivec_cross_sign(int64_t a, int64_t b, int64_t c, int64_t d)
+{
+    int s1 = ((a > 0) - (a < 0)) * ((b > 0) - (b < 0));
+    int s2 = ((c > 0) - (c < 0)) * ((d > 0) - (d < 0));
+    if (s1 != s2)
+        return s1 > s2 ? 1 : -1;
+    uint64_t m1 = (uint64_t)(a < 0 ? -a : a) * (uint64_t)(b < 0 ? -b : b);
+    uint64_t m2 = (uint64_t)(c < 0 ? -c : c) * (uint64_t)(d < 0 ? -d : d);
+    if (m1 == m2)
+        return 0;
+    return (m1 > m2) == (s1 > 0) ? 1 : -1;
+}
 
-    for (int y = y2; y <= y3; ++y)
+// Sets up the triangle for rasterizing into a width x height canvas. Returns false if it covers no pixel there,
+// including when it has no area. Pixels are sampled at their integer coordinates, the same points lines go through
+bool olivec_triangle_init(Olivec_Triangle *t, int x1, int y1, int x2, int y2, int x3, int y3, size_t width, size_t height)
+{
+    // The edge functions are positive inside for counterclockwise triangles, so clockwise ones are turned around
+    int area = olivec_cross_sign((int64_t)x2 - x1, (int64_t)y3 - y1, (int64_t)y2 - y1, (int64_t)x3 - x1);
+    if (area == 0)
+        return false;
+    if (area < 0)
     {
-        if (0 <= y && (size_t)y < height)
-        {
-            // k = (y2 - y1)/(x2 - x1)
-            // c = y - k*x
+        OLIVEC_SWAP(int, x2, x3);
+        OLIVEC_SWAP(int, y2, y3);
+    }
 
-            // y = k*x + c
-            // x = (y - c) / k
-            // x = (y - c) / dy/dx
-            // x = (y - c) * dx/dy
-            int s1 = dy32 != 0 ? (y - y3) * dx32 / dy32 + x3 : x3;
-            int s2 = dy31 != 0 ? (y - y3) * dx31 / dy31 + x3 : x3;
+    int64_t xmin = x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3);
+    int64_t xmax = x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3);
+    int64_t ymin = y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3);
+    int64_t ymax = y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3);
+    t->left = xmin > 0 ? xmin : 0;
+    t->right = xmax < (int64_t)width - 1 ? xmax : (int64_t)width - 1;
+    t->y = ymin > 0 ? ymin : 0;
+    t->bottom = ymax < (int64_t)height - 1 ? ymax : (int64_t)height - 1;
+    if (t->left > t->right || t->y > t->bottom)
+        return false;
 
-            if (s1 > s2)
-                OLIVEC_SWAP(int, s1, s2);
+    int lefts = 0, rights = 0;
+    olivec_triangle_edge(t, &lefts, &rights, x1, y1, x2, y2);
+    olivec_triangle_edge(t, &lefts, &rights, x2, y2, x3, y3);
+    olivec_triangle_edge(t, &lefts, &rights, x3, y3, x1, y1);
+    // Far enough out that stepping never brings them onto the canvas
+    Olivec_Edge none = {.u = INT32_MAX, .r = 0, .d = 1, .q = 0, .m = 0};
+    for (; lefts < 2; ++lefts) t->lefts[lefts] = none;
+    for (; rights < 2; ++rights) t->rights[rights] = none;
+    return t->y <= t->bottom;
+}
 
-            for (int x = s1; x <= s2; ++x)
-            {
-                if (0 <= x && (size_t)x < width)
-                {
-                    pixels[y * width + x] = color;
-                }
-            }
-        }
+// Moves the edge down a row. Whether the remainder carries is as good as random, so it is added rather than branched on
+void olivec_edge_step(Olivec_Edge *edge)
+{
+    int64_t carry = edge->r + edge->m >= edge->d;
+    edge->u += edge->q + carry;
+    edge->r += edge->m - (edge->d & -carry);
+}
+
+// The pixels of the current row inside the triangle, x1 > x2 if there are none. Then moves on to the next row
+void olivec_triangle_row(Olivec_Triangle *t, int64_t *x1, int64_t *x2)
+{
+    int64_t l = t->left, r = t->right;
+    l = -t->lefts[0].u > l ? -t->lefts[0].u : l;
+    l = -t->lefts[1].u > l ? -t->lefts[1].u : l;
+    r = t->rights[0].u < r ? t->rights[0].u : r;
+    r = t->rights[1].u < r ? t->rights[1].u : r;
+    *x1 = l;
+    *x2 = r;
+
+    olivec_edge_step(&t->lefts[0]);
+    olivec_edge_step(&t->lefts[1]);
+    olivec_edge_step(&t->rights[0]);
+    olivec_edge_step(&t->rights[1]);
+    t->y += 1;
+}
+
+// Half-space rasterizer: a pixel is inside when it is on the inner side of all three edges. The bounding box is
+// clipped to the canvas once, and every row finds its span by stepping the edge functions with additions, so no row
+// divides and no pixel is checked against the canvas.
+void olivec_fill_triangle(Olivec_Canvas oc, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color)
+{
+    int xmin = x1 < x2 ? (x1 < x3 ? x1 : x3) : (x2 < x3 ? x2 : x3);
+    int xmax = x1 > x2 ? (x1 > x3 ? x1 : x3) : (x2 > x3 ? x2 : x3);
+    int ymin = y1 < y2 ? (y1 < y3 ? y1 : y3) : (y2 < y3 ? y2 : y3);
+    int ymax = y1 > y2 ? (y1 > y3 ? y1 : y3) : (y2 > y3 ? y2 : y3);
+    olivec_damage_bounds(oc, xmin, ymin, xmax, ymax);
+
+    Olivec_Triangle t;
+    if (!olivec_triangle_init(&t, x1, y1, x2, y2, x3, y3, oc.width, oc.height))
+        return;
+
+    uint32_t *row = &OLIVEC_PIXEL(oc, 0, t.y);
+    while (t.y <= t.bottom)
+    {
+        int64_t s1, s2;
+        olivec_triangle_row(&t, &s1, &s2);
+        if (s1 <= s2)
+            olivec_fill_row_span(row + s1, (size_t)(s2 - s1 + 1), color);
+        row += oc.stride;
     }
 }
 
+// Pixel formats other than the native one. `uint32_t` colors passed to primitives are always native 0xAABBGGRR
+// (RGBA8888 in memory) and converted once per call, so the inner loops only store ready-made pixels.
+//
+// Every format `name` provides olivec_<name>_from_rgba() and olivec_<name>_to_rgba(), and OLIVEC_DEFINE_FORMAT
+// stamps out its canvas type and primitives from them at compile time. The native format is called `rgba`.
+//
+// The primitives walk their pixels with the same Olivec_Line, Olivec_Circle_Rows and Olivec_Triangle as the native
+// ones, so they draw the same pixels, and circles share the span cache. Damage tracking is native only: Olivec_Damage
+// follows an Olivec_Canvas, and drawing on the canvas of another format never reports damage.
+
+typedef Olivec_Canvas Olivec_Canvas_rgba;
+
+uint32_t olivec_rgba_from_rgba(uint32_t color)
+{
+    return color;
+}
+
+uint32_t olivec_rgba_to_rgba(uint32_t pixel)
+{
+    return pixel;
+}
+
+// BGRA8888: red and blue swapped, the layout of most desktop framebuffers
+uint32_t olivec_bgra_from_rgba(uint32_t color)
+{
+    return (color & 0xFF00FF00) | (OLIVEC_RED(color) << (8 * 2)) | OLIVEC_BLUE(color);
+}
+
+uint32_t olivec_bgra_to_rgba(uint32_t pixel)
+{
+    return olivec_bgra_from_rgba(pixel);
+}
+
+// RGB565: 5 bits of red, 6 of green and 5 of blue, no alpha
+uint16_t olivec_rgb565_from_rgba(uint32_t color)
+{
+    return (uint16_t)(((OLIVEC_RED(color) >> 3) << 11) | ((OLIVEC_GREEN(color) >> 2) << 5) | (OLIVEC_BLUE(color) >> 3));
+}
+
+uint32_t olivec_rgb565_to_rgba(uint16_t pixel)
+{
+    // Replicating the top bits into the bottom ones maps the full 5/6 bit range onto the full 8 bit range
+    uint32_t r = (pixel >> 11) & 0x1F;
+    uint32_t g = (pixel >> 5) & 0x3F;
+    uint32_t b = (pixel >> 0) & 0x1F;
+    return OLIVEC_RGBA((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 0xFF);
+}
+
+// GRAY8: 8 bit luma, for masks and monochrome targets
+uint8_t olivec_gray8_from_rgba(uint32_t color)
+{
+    return (uint8_t)((OLIVEC_RED(color) * 77 + OLIVEC_GREEN(color) * 150 + OLIVEC_BLUE(color) * 29) >> 8);
+}
+
+uint32_t olivec_gray8_to_rgba(uint8_t pixel)
+{
+    return OLIVEC_RGBA(pixel, pixel, pixel, 0xFF);
+}
+
+#define OLIVEC_DEFINE_FORMAT(name, T)                                                                                         \
+    typedef struct                                                                                                            \
+    {                                                                                                                         \
+        T *pixels;                                                                                                            \
+        size_t width;                                                                                                         \
+        size_t height;                                                                                                        \
+        size_t stride;                                                                                                        \
+    } Olivec_Canvas_##name;                                                                                                   \
+                                                                                                                              \
+    Olivec_Canvas_##name olivec_canvas_##name(T *pixels, size_t width, size_t height, size_t stride)                          \
+    {                                                                                                                         \
+        Olivec_Canvas_##name oc = {                                                                                           \
+            .pixels = pixels,                                                                                                 \
+            .width = width,                                                                                                   \
+            .height = height,                                                                                                 \
+            .stride = stride,                                                                                                 \
+        };                                                                                                                    \
+        return oc;                                                                                                            \
+    }                                                                                                                         \
+                                                                                                                              \
+    Olivec_Canvas_##name olivec_subcanvas_##name(Olivec_Canvas_##name oc, int x, int y, int w, int h)                         \
+    {                                                                                                                         \
+        Olivec_Normalized_Rect nr;                                                                                            \
+        if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr))                                                     \
+            return (Olivec_Canvas_##name){0};                                                                                 \
+                                                                                                                              \
+        oc.pixels = &OLIVEC_PIXEL(oc, nr.x1, nr.y1);                                                                          \
+        oc.width = (size_t)(nr.x2 - nr.x1 + 1);                                                                               \
+        oc.height = (size_t)(nr.y2 - nr.y1 + 1);                                                                              \
+        return oc;                                                                                                            \
+    }                                                                                                                         \
+                                                                                                                              \
+    void olivec_fill_span_##name(T *dst, size_t count, T pixel)                                                               \
+    {                                                                                                                         \
+        for (size_t i = 0; i < count; ++i)                                                                                    \
+        {                                                                                                                     \
+            dst[i] = pixel;                                                                                                   \
+        }                                                                                                                     \
+    }                                                                                                                         \
+                                                                                                                              \
+    void olivec_fill_##name(Olivec_Canvas_##name oc, uint32_t color)                                                          \
+    {                                                                                                                         \
+        T pixel = olivec_##name##_from_rgba(color);                                                                           \
+        for (size_t y = 0; y < oc.height; ++y)                                                                                \
+        {                                                                                                                     \
+            olivec_fill_span_##name(&OLIVEC_PIXEL(oc, 0, y), oc.width, pixel);                                                \
+        }                                                                                                                     \
+    }                                                                                                                         \
+                                                                                                                              \
+    void olivec_fill_rect_##name(Olivec_Canvas_##name oc, int x, int y, int w, int h, uint32_t color)                         \
+    {                                                                                                                         \
+        Olivec_Normalized_Rect nr;                                                                                            \
+        if (!olivec_normalize_rect(x, y, w, h, oc.width, oc.height, &nr))                                                     \
+            return;                                                                                                           \
+                                                                                                                              \
+        T pixel = olivec_##name##_from_rgba(color);                                                                           \
+        for (int row = nr.y1; row <= nr.y2; ++row)                                                                            \
+        {                                                                                                                     \
+            olivec_fill_span_##name(&OLIVEC_PIXEL(oc, nr.x1, row), (size_t)(nr.x2 - nr.x1 + 1), pixel);                       \
+        }                                                                                                                     \
+    }                                                                                                                         \
+                                                                                                                              \
+    void olivec_fill_circle_##name(Olivec_Canvas_##name oc, int cx, int cy, int r, uint32_t color)                            \
+    {                                                                                                                         \
+        T pixel = olivec_##name##_from_rgba(color);                                                                           \
+        Olivec_Circle_Rows c;                                                                                                 \
+        if (!olivec_circle_rows_init(&c, cx, cy, r, oc.width, oc.height, true))                                               \
+            return;                                                                                                           \
+        while (c.y <= c.bottom)                                                                                               \
+        {                                                                                                                     \
+            int64_t y = c.y;                                                                                                  \
+            int64_t x1, x2;                                                                                                   \
+            olivec_circle_rows_step(&c, &x1, &x2);                                                                            \
+            if (x1 < 0)                                                                                                       \
+                x1 = 0;                                                                                                       \
+            if (x2 >= (int64_t)oc.width)                                                                                      \
+                x2 = (int64_t)oc.width - 1;                                                                                   \
+            if (x1 <= x2)                                                                                                     \
+                olivec_fill_span_##name(&OLIVEC_PIXEL(oc, x1, y), (size_t)(x2 - x1 + 1), pixel);                              \
+        }                                                                                                                     \
+    }                                                                                                                         \
+                                                                                                                              \
+    OLIVEC_DEFINE_WALK_LINE(olivec_walk_line_##name, T)                                                                       \
+                                                                                                                              \
+    void olivec_draw_line_##name(Olivec_Canvas_##name oc, int x1, int y1, int x2, int y2, uint32_t color)                     \
+    {                                                                                                                         \
+        T pixel = olivec_##name##_from_rgba(color);                                                                           \
+        Olivec_Line line;                                                                                                     \
+        if (!olivec_clip_line_rect(x1, y1, x2, y2, 0, 0, (int64_t)oc.width - 1, (int64_t)oc.height - 1, &line))               \
+            return;                                                                                                           \
+        olivec_walk_line_##name(&OLIVEC_PIXEL(oc, line.x, line.y), oc.stride, &line, pixel);                                  \
+    }                                                                                                                         \
+                                                                                                                              \
+    void olivec_fill_triangle_##name(Olivec_Canvas_##name oc, int x1, int y1, int x2, int y2, int x3, int y3, uint32_t color) \
+    {                                                                                                                         \
+        T pixel = olivec_##name##_from_rgba(color);                                                                           \
+        Olivec_Triangle t;                                                                                                    \
+        if (!olivec_triangle_init(&t, x1, y1, x2, y2, x3, y3, oc.width, oc.height))                                           \
+            return;                                                                                                           \
+        while (t.y <= t.bottom)                                                                                               \
+        {                                                                                                                     \
+            int64_t y = t.y;                                                                                                  \
+            int64_t s1, s2;                                                                                                   \
+            olivec_triangle_row(&t, &s1, &s2);                                                                                \
+            if (s1 <= s2)                                                                                                     \
+                olivec_fill_span_##name(&OLIVEC_PIXEL(oc, s1, y), (size_t)(s2 - s1 + 1), pixel);                              \
+        }                                                                                                                     \
+    }
+
+#define OLIVEC_DEFINE_BLIT(from, to)                                                                                 \
+    void olivec_blit_##from##_to_##to(Olivec_Canvas_##to dst, Olivec_Canvas_##from src)                              \
+    {                                                                                                                \
+        size_t width = dst.width < src.width ? dst.width : src.width;                                                \
+        size_t height = dst.height < src.height ? dst.height : src.height;                                           \
+        for (size_t y = 0; y < height; ++y)                                                                          \
+        {                                                                                                            \
+            for (size_t x = 0; x < width; ++x)                                                                       \
+            {                                                                                                        \
+                OLIVEC_PIXEL(dst, x, y) = olivec_##to##_from_rgba(olivec_##from##_to_rgba(OLIVEC_PIXEL(src, x, y))); \
+            }                                                                                                        \
+        }                                                                                                            \
+    }
+
+OLIVEC_DEFINE_FORMAT(bgra, uint32_t)
+OLIVEC_DEFINE_FORMAT(rgb565, uint16_t)
+OLIVEC_DEFINE_FORMAT(gray8, uint8_t)
+
+OLIVEC_DEFINE_BLIT(rgba, bgra)
+OLIVEC_DEFINE_BLIT(rgba, rgb565)
+OLIVEC_DEFINE_BLIT(rgba, gray8)
+OLIVEC_DEFINE_BLIT(bgra, rgba)
+OLIVEC_DEFINE_BLIT(bgra, rgb565)
+OLIVEC_DEFINE_BLIT(bgra, gray8)
+OLIVEC_DEFINE_BLIT(rgb565, rgba)
+OLIVEC_DEFINE_BLIT(rgb565, bgra)
+OLIVEC_DEFINE_BLIT(rgb565, gray8)
+OLIVEC_DEFINE_BLIT(gray8, rgba)
+OLIVEC_DEFINE_BLIT(gray8, bgra)
+OLIVEC_DEFINE_BLIT(gray8, rgb565)
+
 #endif // OLIVE_C_
\ No newline at end of file
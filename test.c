@@ -1,8 +1,10 @@
+#define _DEFAULT_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "./stb_image_write.h"
@@ -68,7 +70,8 @@ const char *display_hexcolor(uint32_t c)
     return buffer;
 }
 
-uint32_t pixels[WIDTH * HEIGHT];
+// Allocated in main() with olivec_canvas_alloc(). WIDTH is a multiple of the row alignment, so rows stay packed.
+uint32_t *pixels = NULL;
 
 bool record_test_case(const char *file_path)
 {
@@ -159,61 +162,622 @@ typedef struct
         .failure_file_path = TEST_DIR_PATH "/" #name "_failure.png" \
     }
 
+// Reference rendering for the tests that draw the same scene two ways
+uint32_t reference_pixels[WIDTH * HEIGHT];
+
+// Paints every pixel that differs from reference_pixels with ERROR_COLOR, which no recorded image contains, so the
+// test fails even when it is being recorded by mistake. Returns whether they all matched
+bool expect_reference_pixels(void)
+{
+    bool matched = true;
+    for (size_t i = 0; i < WIDTH * HEIGHT; ++i)
+    {
+        if (pixels[i] != reference_pixels[i])
+        {
+            pixels[i] = ERROR_COLOR;
+            matched = false;
+        }
+    }
+    return matched;
+}
+
+// Deterministic on every libc, unlike rand(), so the recorded images do not depend on the platform
+int random_between(uint32_t *state, int min, int max)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return min + (int)(*state % (uint32_t)(max - min + 1));
+}
+
+// Row y is a span of y pixels starting y % 17 pixels into the row, so the kernels see every length up to the width
+// and every misalignment of the start and the end
+void fill_span_rows(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        size_t x = y % 17;
+        size_t count = y < WIDTH - x ? y : WIDTH - x;
+        olivec_fill_span(&OLIVEC_PIXEL(oc, x, y), count, y % 2 == 0 ? RED_COLOR : BLUE_COLOR);
+    }
+}
+
+void test_fill_span(void)
+{
+    // Every kernel the CPU can run has to match the scalar one, not only the one olivec_simd_detect() picks
+    Olivec_Simd detected = olivec_simd_detect();
+    olivec_simd_use(OLIVEC_SIMD_SCALAR);
+    fill_span_rows();
+    memcpy(reference_pixels, pixels, sizeof(reference_pixels));
+
+    for (Olivec_Simd simd = OLIVEC_SIMD_SCALAR + 1; simd <= detected; ++simd)
+    {
+        olivec_simd_use(simd);
+        fill_span_rows();
+        if (!expect_reference_pixels())
+        {
+            fprintf(stderr, "test_fill_span: the %s kernel differs from the scalar one\n", olivec_simd_name(simd));
+            break;
+        }
+    }
+    olivec_simd_use(detected);
+}
+
 void test_fill_rect(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
-    olivec_fill_rect(pixels, WIDTH, HEIGHT, WIDTH / 2 - WIDTH / 8, HEIGHT / 2 - HEIGHT / 8, WIDTH / 4, HEIGHT / 4, RED_COLOR);
-    olivec_fill_rect(pixels, WIDTH, HEIGHT, WIDTH - 1, HEIGHT - 1, -WIDTH / 2, -HEIGHT / 2, GREEN_COLOR);
-    olivec_fill_rect(pixels, WIDTH, HEIGHT, -WIDTH / 4, -HEIGHT / 4, WIDTH / 2, HEIGHT / 2, BLUE_COLOR);
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_rect(oc, WIDTH / 2 - WIDTH / 8, HEIGHT / 2 - HEIGHT / 8, WIDTH / 4, HEIGHT / 4, RED_COLOR);
+    olivec_fill_rect(oc, WIDTH - 1, HEIGHT - 1, -WIDTH / 2, -HEIGHT / 2, GREEN_COLOR);
+    olivec_fill_rect(oc, -WIDTH / 4, -HEIGHT / 4, WIDTH / 2, HEIGHT / 2, BLUE_COLOR);
+}
+
+// Fills the rect as columns of odd widths, so their starts and ends fall on every alignment
+void fill_rect_columns(Olivec_Canvas oc, int x, int y, int w, int h, uint32_t color)
+{
+    for (int i = 0, cx = x; cx < x + w; ++i)
+    {
+        int cw = 1 + 2 * (i % 7);
+        cw = cw < x + w - cx ? cw : x + w - cx;
+        olivec_fill_rect(oc, cx, y, cw, h, color);
+        cx += cw;
+    }
+}
+
+// Compared against the image of test_fill_rect
+void test_fill_rect_stream(void)
+{
+    test_fill_rect();
+    memcpy(reference_pixels, pixels, sizeof(reference_pixels));
+
+    // Non-temporal stores only kick in for fills far bigger than a test canvas, so every fill streams with the
+    // threshold at 0. The scene of test_fill_rect is redrawn with each rect cut into columns, with every kernel
+    size_t threshold = olivec_stream_threshold;
+    olivec_stream_threshold = 0;
+    Olivec_Simd detected = olivec_simd_detect();
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    for (Olivec_Simd simd = OLIVEC_SIMD_SCALAR; simd <= detected; ++simd)
+    {
+        olivec_simd_use(simd);
+        fill_rect_columns(oc, 0, 0, WIDTH, HEIGHT, BACKGROUND_COLOR);
+        fill_rect_columns(oc, WIDTH / 2 - WIDTH / 8, HEIGHT / 2 - HEIGHT / 8, WIDTH / 4, HEIGHT / 4, RED_COLOR);
+        fill_rect_columns(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 2, HEIGHT / 2, GREEN_COLOR);
+        fill_rect_columns(oc, 0, 0, WIDTH / 4, HEIGHT / 4, BLUE_COLOR);
+        if (!expect_reference_pixels())
+        {
+            fprintf(stderr, "test_fill_rect_stream: the %s stream kernel differs\n", olivec_simd_name(simd));
+            break;
+        }
+    }
+    olivec_simd_use(detected);
+    olivec_stream_threshold = threshold;
 }
 
 void test_fill_circle(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
-    olivec_fill_circle(pixels, WIDTH, HEIGHT, 0, 0, WIDTH / 2, RED_COLOR);
-    olivec_fill_circle(pixels, WIDTH, HEIGHT, WIDTH / 2, HEIGHT / 2, WIDTH / 4, BLUE_COLOR);
-    olivec_fill_circle(pixels, WIDTH, HEIGHT, WIDTH * 3 / 4, HEIGHT * 3 / 4, -WIDTH / 4, GREEN_COLOR);
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_circle(oc, 0, 0, WIDTH / 2, RED_COLOR);
+    olivec_fill_circle(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 4, BLUE_COLOR);
+    olivec_fill_circle(oc, WIDTH * 3 / 4, HEIGHT * 3 / 4, -WIDTH / 4, GREEN_COLOR);
+}
+
+void test_fill_circle_aa(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_circle_aa(oc, 0, 0, WIDTH / 2, RED_COLOR);
+    olivec_fill_circle_aa(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 4, BLUE_COLOR);
+    olivec_fill_circle_aa(oc, WIDTH * 3 / 4, HEIGHT * 3 / 4, -WIDTH / 4, GREEN_COLOR & 0x80FFFFFF);
+    olivec_fill_circle_aa(oc, WIDTH / 8, HEIGHT * 7 / 8, 3, 0xFFFFFFFF);
+}
+
+void test_draw_circle(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_ring(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 4, WIDTH * 3 / 8, RED_COLOR);
+    olivec_draw_circle(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 8, GREEN_COLOR);
+    olivec_draw_circle(oc, WIDTH / 2, HEIGHT / 2, WIDTH * 3 / 8, BLUE_COLOR);
+    olivec_fill_ring(oc, 0, HEIGHT, -WIDTH / 8, WIDTH / 16, GREEN_COLOR);
+    olivec_draw_circle(oc, WIDTH, 0, WIDTH / 4, 0xFFFFFFFF);
+}
+
+void test_fill_arc(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_arc(oc, WIDTH / 4, HEIGHT / 4, 0, WIDTH / 5, OLIVEC_PI / 6, OLIVEC_PI * 3 / 2, RED_COLOR);
+    olivec_fill_arc(oc, WIDTH * 3 / 4, HEIGHT / 4, WIDTH / 10, WIDTH / 5, -OLIVEC_PI / 4, OLIVEC_PI / 4, GREEN_COLOR);
+    olivec_fill_arc(oc, WIDTH / 4, HEIGHT * 3 / 4, WIDTH / 8, WIDTH / 5, OLIVEC_PI, OLIVEC_PI / 2, BLUE_COLOR);
+    olivec_fill_arc(oc, WIDTH * 3 / 4, HEIGHT * 3 / 4, 0, WIDTH / 5, 0, OLIVEC_PI, 0xFFFFFFFF);
+    olivec_fill_arc(oc, WIDTH, HEIGHT / 2, 0, WIDTH / 8, 0, 2 * OLIVEC_PI, RED_COLOR);
+    // Empty sweeps, also when the end is a whole turn before the start, fill nothing
+    olivec_fill_arc(oc, WIDTH / 2, HEIGHT / 2, 0, WIDTH / 4, OLIVEC_PI / 3, OLIVEC_PI / 3, RED_COLOR);
+    olivec_fill_arc(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 8, WIDTH / 4, OLIVEC_PI, -OLIVEC_PI, GREEN_COLOR);
+}
+
+void test_fill_ellipse(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_ellipse(oc, WIDTH / 2, HEIGHT / 4, WIDTH * 3 / 8, HEIGHT / 8, RED_COLOR);
+    olivec_fill_ellipse(oc, 0, HEIGHT / 2, -WIDTH / 8, HEIGHT / 3, GREEN_COLOR);
+    olivec_fill_ellipse_rotated(oc, WIDTH / 2, HEIGHT * 5 / 8, WIDTH * 3 / 8, HEIGHT / 8, OLIVEC_PI / 6, BLUE_COLOR);
+    olivec_fill_ellipse_rotated(oc, WIDTH * 7 / 8, HEIGHT * 7 / 8, WIDTH / 4, HEIGHT / 16, -OLIVEC_PI / 3, 0xFFFFFFFF);
 }
 
 void test_draw_line(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
-    olivec_draw_line(pixels, WIDTH, HEIGHT, 0, 0, WIDTH, HEIGHT, RED_COLOR);
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH, 0, 0, HEIGHT, BLUE_COLOR);
-    olivec_draw_line(pixels, WIDTH, HEIGHT, WIDTH / 2, 0, WIDTH / 2, HEIGHT, GREEN_COLOR);
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_draw_line(oc, 0, 0, WIDTH, HEIGHT, RED_COLOR);
+    olivec_draw_line(oc, WIDTH, 0, 0, HEIGHT, BLUE_COLOR);
+    olivec_draw_line(oc, WIDTH / 2, 0, WIDTH / 2, HEIGHT, GREEN_COLOR);
+}
+
+void test_draw_line_aa(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_draw_line_aa(oc, 0, 0, WIDTH, HEIGHT, RED_COLOR);
+    olivec_draw_line_aa(oc, WIDTH, 0, 0, HEIGHT, BLUE_COLOR);
+    olivec_draw_line_aa(oc, WIDTH / 4, HEIGHT, WIDTH * 3 / 4, 0, GREEN_COLOR & 0x80FFFFFF);
+    olivec_draw_line_aa(oc, -WIDTH, HEIGHT / 3, WIDTH * 2, HEIGHT / 2, 0xFFFFFFFF);
+}
+
+void test_draw_polyline(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+
+    Olivec_Point wave[16];
+    for (int i = 0; i < 16; ++i)
+    {
+        wave[i].x = -WIDTH / 8 + i * WIDTH * 5 / 4 / 15;
+        wave[i].y = HEIGHT / 2 + (i % 2 == 0 ? -1 : 1) * (i % 3 + 1) * HEIGHT / 8;
+    }
+    olivec_draw_polyline(oc, wave, 16, RED_COLOR);
+
+    Olivec_Point square[] = {
+        {WIDTH / 4, HEIGHT / 4},
+        {WIDTH * 3 / 4, HEIGHT / 4},
+        {WIDTH * 3 / 4, HEIGHT * 3 / 4},
+        {WIDTH / 4, HEIGHT * 3 / 4},
+        {WIDTH / 4, HEIGHT / 4},
+    };
+    olivec_draw_polyline(oc, square, 5, GREEN_COLOR);
+}
+
+void test_draw_line_pattern(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+
+    // The dashes run on around the corners and across the off-canvas part of the first segment
+    Olivec_Line_Pattern dashed = olivec_dash(6, 3);
+    Olivec_Point zigzag[] = {
+        {-WIDTH / 2, HEIGHT / 8},
+        {WIDTH / 4, HEIGHT / 2},
+        {WIDTH / 2, HEIGHT / 8},
+        {WIDTH * 3 / 4, HEIGHT / 2},
+        {WIDTH * 3 / 4, HEIGHT / 4},
+    };
+    olivec_draw_polyline_pattern(oc, zigzag, 5, &dashed, RED_COLOR);
+
+    Olivec_Line_Pattern dotted = olivec_dash(1, 2);
+    olivec_draw_line_pattern(oc, WIDTH * 7 / 8, HEIGHT * 7 / 8, WIDTH / 8, HEIGHT * 5 / 8, &dotted, GREEN_COLOR);
+    olivec_draw_line_pattern(oc, WIDTH / 8, HEIGHT * 5 / 8, WIDTH / 8, HEIGHT * 7 / 8, &dotted, GREEN_COLOR);
+
+    Olivec_Line_Pattern dash_dot = {0x2F, 9, 0};
+    olivec_draw_line_pattern(oc, WIDTH / 8, HEIGHT * 15 / 16, WIDTH * 7 / 8, HEIGHT * 15 / 16, &dash_dot, BLUE_COLOR);
+
+    // Periods past 64 pixels are scaled down to 32 on and 32 off, and a pattern without a length is solid
+    Olivec_Line_Pattern long_dash = olivec_dash(40, 40);
+    olivec_draw_line_pattern(oc, 0, HEIGHT / 32, WIDTH - 1, HEIGHT / 32, &long_dash, 0xFFFFFFFF);
+    Olivec_Line_Pattern empty = {0};
+    olivec_draw_line_pattern(oc, WIDTH / 8, HEIGHT / 16, WIDTH * 7 / 8, HEIGHT / 16, &empty, 0xFFFFFFFF);
+    Olivec_Line_Pattern none = olivec_dash(0, 0);
+    Olivec_Point edge[] = {{WIDTH * 15 / 16, HEIGHT / 8}, {WIDTH * 15 / 16, HEIGHT * 7 / 8}};
+    olivec_draw_polyline_pattern(oc, edge, 2, &none, 0xFFFFFFFF);
+}
+
+void test_stroke_polyline(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+
+    Olivec_Join joins[] = {OLIVEC_JOIN_MITER, OLIVEC_JOIN_ROUND, OLIVEC_JOIN_BEVEL};
+    Olivec_Cap caps[] = {OLIVEC_CAP_BUTT, OLIVEC_CAP_ROUND, OLIVEC_CAP_SQUARE};
+    uint32_t colors[] = {RED_COLOR, GREEN_COLOR, BLUE_COLOR};
+    for (int i = 0; i < 3; ++i)
+    {
+        int y = HEIGHT / 8 + i * HEIGHT / 4;
+        Olivec_Point points[] = {
+            {WIDTH / 8, y + HEIGHT / 8},
+            {WIDTH * 3 / 8, y},
+            {WIDTH / 2, y + HEIGHT / 6},
+            {WIDTH * 7 / 8, y + HEIGHT / 16},
+        };
+        olivec_stroke_polyline(oc, points, 4, WIDTH / 16, caps[i], joins[i], colors[i]);
+    }
+    olivec_draw_thick_line(oc, WIDTH / 8, HEIGHT * 15 / 16, WIDTH * 7 / 8, HEIGHT * 7 / 8, 3, OLIVEC_CAP_ROUND, 0xFFFFFFFF);
 }
 
 void test_fill_triangle(void)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, BACKGROUND_COLOR);
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
 
     {
         int x1 = WIDTH / 2, y1 = HEIGHT / 8;
         int x2 = WIDTH / 8, y2 = HEIGHT / 2;
         int x3 = WIDTH * 7 / 8, y3 = HEIGHT * 7 / 8;
-        olivec_fill_triangle(pixels, WIDTH, HEIGHT, x1, y1, x2, y2, x3, y3, RED_COLOR);
+        olivec_fill_triangle(oc, x1, y1, x2, y2, x3, y3, RED_COLOR);
     }
 
     {
         int x1 = WIDTH / 2, y1 = HEIGHT * 2 / 8;
         int x2 = WIDTH * 2 / 8, y2 = HEIGHT / 2;
         int x3 = WIDTH * 6 / 8, y3 = HEIGHT / 2;
-        olivec_fill_triangle(pixels, WIDTH, HEIGHT, x1, y1, x2, y2, x3, y3, GREEN_COLOR);
+        olivec_fill_triangle(oc, x1, y1, x2, y2, x3, y3, GREEN_COLOR);
     }
 
     {
         int x1 = WIDTH / 8, y1 = HEIGHT / 8;
         int x2 = WIDTH / 8, y2 = HEIGHT * 3 / 8;
         int x3 = WIDTH * 3 / 8, y3 = HEIGHT * 3 / 8;
-        olivec_fill_triangle(pixels, WIDTH, HEIGHT, x1, y1, x2, y2, x3, y3, BLUE_COLOR);
+        olivec_fill_triangle(oc, x1, y1, x2, y2, x3, y3, BLUE_COLOR);
+    }
+}
+
+void test_subcanvas(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+
+    // Everything drawn into a view is relative to its corner and clipped against its bounds
+    Olivec_Canvas tile = olivec_subcanvas(oc, WIDTH / 8, HEIGHT / 8, WIDTH / 2, HEIGHT / 2);
+    olivec_fill(tile, RED_COLOR);
+    olivec_fill_circle(tile, 0, 0, WIDTH / 4, BLUE_COLOR);
+    olivec_fill_rect(tile, WIDTH / 4, HEIGHT / 4, WIDTH, HEIGHT, GREEN_COLOR);
+
+    // Views of views, and views that hang off the canvas edge
+    Olivec_Canvas corner = olivec_subcanvas(oc, WIDTH * 5 / 8, HEIGHT * 5 / 8, WIDTH, HEIGHT);
+    olivec_fill(corner, BLUE_COLOR);
+    olivec_fill(olivec_subcanvas(corner, -WIDTH, -HEIGHT, WIDTH + WIDTH / 8, HEIGHT + HEIGHT / 8), GREEN_COLOR);
+    olivec_fill_circle(corner, WIDTH / 4, HEIGHT / 4, WIDTH / 8, RED_COLOR);
+}
+
+// Runs `draw` split across worker threads however little work it has, restoring the thread pool settings afterwards
+void run_on_workers(void (*draw)(void))
+{
+    size_t threshold = olivec_parallel_threshold;
+    olivec_parallel_threshold = 0;
+    olivec_threads_start(3);
+    draw();
+    olivec_threads_stop();
+    olivec_parallel_threshold = threshold;
+}
+
+void test_fill_parallel(void)
+{
+    // Splitting the work across threads must not change a single pixel, so this has to match test_fill_rect
+    run_on_workers(test_fill_rect);
+}
+
+// More rects than fit into one batch of olivec_fill_rects()
+#define TEST_RECTS_COUNT (OLIVEC_RECTS_BATCH + 64)
+
+Olivec_Rect test_rects[TEST_RECTS_COUNT];
+uint32_t test_rect_colors[TEST_RECTS_COUNT];
+
+void fill_test_rects(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_rects(oc, test_rects, test_rect_colors, TEST_RECTS_COUNT);
+}
+
+void test_fill_rects(void)
+{
+    // Rects of both signs, partly or fully off the canvas and overlapping each other in every order
+    uint32_t state = 0x2545F491;
+    for (size_t i = 0; i < TEST_RECTS_COUNT; ++i)
+    {
+        test_rects[i].x = random_between(&state, -WIDTH / 4, WIDTH * 5 / 4);
+        test_rects[i].y = random_between(&state, -HEIGHT / 4, HEIGHT * 5 / 4);
+        test_rects[i].w = random_between(&state, -WIDTH / 4, WIDTH / 4);
+        test_rects[i].h = random_between(&state, -HEIGHT / 4, HEIGHT / 4);
+        test_rect_colors[i] = 0xFF000000 | (uint32_t)random_between(&state, 0, 0xFFFFFF);
+    }
+
+    Olivec_Canvas reference = olivec_canvas(reference_pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(reference, BACKGROUND_COLOR);
+    for (size_t i = 0; i < TEST_RECTS_COUNT; ++i)
+    {
+        Olivec_Rect r = test_rects[i];
+        olivec_fill_rect(reference, r.x, r.y, r.w, r.h, test_rect_colors[i]);
+    }
+
+    // Batched, first on the calling thread and then split across workers, it has to match drawing them one by one
+    fill_test_rects();
+    expect_reference_pixels();
+    run_on_workers(fill_test_rects);
+    expect_reference_pixels();
+}
+
+#define TEST_CIRCLES_COUNT 256
+
+int test_circle_xs[TEST_CIRCLES_COUNT];
+int test_circle_ys[TEST_CIRCLES_COUNT];
+int test_circle_rs[TEST_CIRCLES_COUNT];
+uint32_t test_circle_colors[TEST_CIRCLES_COUNT];
+
+void fill_test_circles(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_circles(oc, test_circle_xs, test_circle_ys, test_circle_rs, test_circle_colors, TEST_CIRCLES_COUNT);
+}
+
+void test_fill_circles(void)
+{
+    // Circles of both signs of radius, some hanging off the canvas or entirely outside of it, overlapping across tiles
+    uint32_t state = 0x9E3779B9;
+    for (size_t i = 0; i < TEST_CIRCLES_COUNT; ++i)
+    {
+        test_circle_xs[i] = random_between(&state, -WIDTH / 2, WIDTH * 3 / 2);
+        test_circle_ys[i] = random_between(&state, -HEIGHT / 2, HEIGHT * 3 / 2);
+        test_circle_rs[i] = random_between(&state, -WIDTH / 4, WIDTH / 4);
+        test_circle_colors[i] = 0xFF000000 | (uint32_t)random_between(&state, 0, 0xFFFFFF);
+    }
+
+    Olivec_Canvas reference = olivec_canvas(reference_pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(reference, BACKGROUND_COLOR);
+    for (size_t i = 0; i < TEST_CIRCLES_COUNT; ++i)
+        olivec_fill_circle(reference, test_circle_xs[i], test_circle_ys[i], test_circle_rs[i], test_circle_colors[i]);
+
+    // Binned into tiles, first on the calling thread and then split across workers, it has to match drawing them one
+    // by one
+    fill_test_circles();
+    expect_reference_pixels();
+    run_on_workers(fill_test_circles);
+    expect_reference_pixels();
+}
+
+// The radii 1..OLIVEC_SPAN_CACHE_SLOTS + 1 in a grid, one more than the cache has slots
+void fill_span_cache_circles(Olivec_Canvas oc, void (*fill)(Olivec_Canvas, int, int, int, uint32_t))
+{
+    olivec_fill(oc, BACKGROUND_COLOR);
+    for (int r = 1; r <= OLIVEC_SPAN_CACHE_SLOTS + 1; ++r)
+        fill(oc, 16 + (r - 1) % 4 * 32, 12 + (r - 1) / 4 * 25, r, r % 2 == 0 ? RED_COLOR : BLUE_COLOR);
+}
+
+#ifdef OLIVEC_THREADS
+// Fills a circle on a canvas of its own and returns whether it was the only lookup in the cache of the thread
+void *fill_circle_on_thread(void *arg)
+{
+    (void)arg;
+    uint32_t thread_pixels[3 * 3];
+    olivec_fill_circle(olivec_canvas(thread_pixels, 3, 3, 3), 1, 1, 1, GREEN_COLOR);
+    return (void *)(uintptr_t)(olivec_span_cache.hits == 0 && olivec_span_cache.misses == 1);
+}
+#endif
+
+void test_span_cache(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    fill_span_cache_circles(olivec_canvas(reference_pixels, WIDTH, HEIGHT, WIDTH), olivec_fill_circle_rows);
+
+    // The last radius evicts the first, which was used least recently, so the second pass misses on the first radius,
+    // evicting the second, and so on: every lookup misses, and the widths computed again must be the same
+    olivec_span_cache_reset();
+    fill_span_cache_circles(oc, olivec_fill_circle);
+    fill_span_cache_circles(oc, olivec_fill_circle);
+    bool counted = olivec_span_cache.hits == 0 && olivec_span_cache.misses == 2 * (OLIVEC_SPAN_CACHE_SLOTS + 1);
+
+    // Drawing the most recent radii again hits without evicting anything
+    olivec_fill_circle(oc, 16 + (OLIVEC_SPAN_CACHE_SLOTS - 1) % 4 * 32, 12 + (OLIVEC_SPAN_CACHE_SLOTS - 1) / 4 * 25,
+                       OLIVEC_SPAN_CACHE_SLOTS, RED_COLOR);
+    olivec_fill_circle(oc, 16 + OLIVEC_SPAN_CACHE_SLOTS % 4 * 32, 12 + OLIVEC_SPAN_CACHE_SLOTS / 4 * 25,
+                       OLIVEC_SPAN_CACHE_SLOTS + 1, BLUE_COLOR);
+    counted = counted && olivec_span_cache.hits == 2 && olivec_span_cache.misses == 2 * (OLIVEC_SPAN_CACHE_SLOTS + 1);
+
+#ifdef OLIVEC_THREADS
+    // Another thread starts out with a cache of its own and leaves the one of this thread alone
+    pthread_t thread;
+    void *own_cache = NULL;
+    if (pthread_create(&thread, NULL, fill_circle_on_thread, NULL) == 0)
+        pthread_join(thread, &own_cache);
+    counted = counted && own_cache != NULL && olivec_span_cache.hits == 2 &&
+              olivec_span_cache.misses == 2 * (OLIVEC_SPAN_CACHE_SLOTS + 1);
+#endif
+
+    if (!counted)
+    {
+        fprintf(stderr, "test_span_cache: unexpected %zu hits and %zu misses\n", olivec_span_cache.hits, olivec_span_cache.misses);
+        olivec_fill(oc, ERROR_COLOR);
     }
+    expect_reference_pixels();
+}
+
+void test_damage(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, ERROR_COLOR);
+
+    // Only the damaged regions get cleared between frames, so nothing of the first frame may survive the second
+    Olivec_Damage damage = {0};
+    olivec_damage_begin(&damage, oc, BACKGROUND_COLOR);
+    olivec_fill_circle(oc, WIDTH / 4, HEIGHT / 4, WIDTH / 8, RED_COLOR);
+    olivec_fill_rect(olivec_subcanvas(oc, WIDTH / 2, 0, WIDTH / 2, HEIGHT / 2), WIDTH / 8, HEIGHT / 8, WIDTH / 4, HEIGHT / 4, GREEN_COLOR);
+    olivec_damage_end(&damage);
+
+    olivec_damage_begin(&damage, oc, BACKGROUND_COLOR);
+    olivec_fill_circle(oc, WIDTH * 3 / 4, HEIGHT * 3 / 4, WIDTH / 8, RED_COLOR);
+    olivec_fill_triangle(oc, WIDTH / 8, HEIGHT / 2, WIDTH / 2, HEIGHT * 7 / 8, WIDTH / 8, HEIGHT * 7 / 8, BLUE_COLOR);
+    olivec_damage_end(&damage);
+}
+
+// Paints every pixel that was drawn but is outside of the damage of the frame with ERROR_COLOR
+void expect_damage_covers_drawing(const Olivec_Damage *damage)
+{
+    for (size_t y = 0; y < HEIGHT; ++y)
+    {
+        for (size_t x = 0; x < WIDTH; ++x)
+        {
+            if (pixels[y * WIDTH + x] == BACKGROUND_COLOR)
+                continue;
+            bool covered = false;
+            for (size_t i = 0; i < damage->count && !covered; ++i)
+            {
+                Olivec_Rect r = damage->rects[i];
+                covered = r.x <= (int)x && (int)x < r.x + r.w && r.y <= (int)y && (int)y < r.y + r.h;
+            }
+            if (!covered)
+                pixels[y * WIDTH + x] = ERROR_COLOR;
+        }
+    }
+}
+
+void test_extreme_coordinates(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, BACKGROUND_COLOR);
+
+    // Coordinates anywhere in the int range, with damage tracking on, must neither overflow nor lose damage
+    // The first frame on a canvas damages all of it, so the primitives go into the second one
+    Olivec_Damage damage = {0};
+    olivec_damage_begin(&damage, oc, BACKGROUND_COLOR);
+    olivec_damage_end(&damage);
+    olivec_damage_begin(&damage, oc, BACKGROUND_COLOR);
+    olivec_fill_triangle(oc, INT_MAX - 2, INT_MAX - 2, INT_MAX, INT_MIN, INT_MIN + 1, INT_MIN, 0xFFFFFFFF);
+    olivec_fill_triangle(oc, WIDTH / 2, HEIGHT / 2, INT_MIN, INT_MAX, INT_MAX, INT_MAX, BLUE_COLOR);
+    olivec_fill_circle(oc, INT_MIN + WIDTH / 8, HEIGHT / 2, INT_MIN, GREEN_COLOR);
+    olivec_fill_circle_aa(oc, WIDTH / 2, INT_MAX, INT_MAX - HEIGHT * 7 / 8, BLUE_COLOR);
+    olivec_draw_circle(oc, INT_MIN, INT_MIN, INT_MIN, RED_COLOR);
+    olivec_draw_circle(oc, INT_MAX, HEIGHT / 2, INT_MAX - WIDTH * 7 / 8, RED_COLOR);
+    olivec_draw_line(oc, INT_MIN, INT_MIN, INT_MAX, INT_MAX, RED_COLOR);
+    olivec_draw_line(oc, INT_MIN, HEIGHT / 4, INT_MAX, HEIGHT / 4, GREEN_COLOR);
+    olivec_draw_line(oc, WIDTH / 4, INT_MAX, WIDTH / 4, INT_MIN, GREEN_COLOR);
+    olivec_draw_line_aa(oc, INT_MAX, WIDTH - 1 - INT_MAX, WIDTH - 1 - INT_MAX, INT_MAX, BLUE_COLOR);
+    olivec_damage_end(&damage);
+    expect_damage_covers_drawing(&damage);
+}
+
+void test_mmap_canvas(void)
+{
+    const char *file_path = TEST_DIR_PATH "/test_mmap_canvas.bin";
+
+    Olivec_Canvas oc = olivec_canvas_mmap(file_path, WIDTH, HEIGHT);
+    if (oc.pixels == NULL)
+    {
+        fprintf(stderr, "ERROR: could not map %s: %s\n", file_path, strerror(errno));
+        exit(1);
+    }
+    olivec_fill(oc, BACKGROUND_COLOR);
+    olivec_fill_circle(oc, WIDTH / 2, HEIGHT / 2, WIDTH / 3, GREEN_COLOR);
+    olivec_fill_rect(oc, WIDTH / 2, HEIGHT / 2, WIDTH, HEIGHT, BLUE_COLOR);
+    olivec_canvas_munmap(oc);
+
+    // Whatever was drawn has to come back from the file
+    oc = olivec_canvas_mmap(file_path, WIDTH, HEIGHT);
+    if (oc.pixels == NULL)
+    {
+        fprintf(stderr, "ERROR: could not map %s: %s\n", file_path, strerror(errno));
+        exit(1);
+    }
+    memcpy(pixels, oc.pixels, WIDTH * HEIGHT * sizeof(uint32_t));
+    olivec_canvas_munmap(oc);
+    remove(file_path);
+}
+
+#define FORMAT_WIDTH (WIDTH / 2)
+#define FORMAT_HEIGHT (HEIGHT / 2)
+
+// Draws the same scene with the primitives specialized for `name` and blits it back into a quadrant of `oc`
+#define DRAW_FORMAT_QUADRANT(name, T, oc, qx, qy)                                                                                                   \
+    do                                                                                                                                              \
+    {                                                                                                                                               \
+        static T name##_pixels[FORMAT_WIDTH * FORMAT_HEIGHT];                                                                                       \
+        Olivec_Canvas_##name name##_oc = olivec_canvas_##name(name##_pixels, FORMAT_WIDTH, FORMAT_HEIGHT, FORMAT_WIDTH);                            \
+        olivec_fill_##name(name##_oc, BACKGROUND_COLOR);                                                                                            \
+        olivec_fill_rect_##name(name##_oc, FORMAT_WIDTH / 8, FORMAT_HEIGHT / 8, FORMAT_WIDTH / 2, FORMAT_HEIGHT / 4, RED_COLOR);                    \
+        olivec_fill_circle_##name(name##_oc, FORMAT_WIDTH * 2 / 3, FORMAT_HEIGHT * 2 / 3, FORMAT_WIDTH / 4, GREEN_COLOR);                           \
+        olivec_fill_triangle_##name(name##_oc, 0, FORMAT_HEIGHT, FORMAT_WIDTH / 2, FORMAT_HEIGHT / 2, FORMAT_WIDTH / 2, FORMAT_HEIGHT, BLUE_COLOR); \
+        olivec_draw_line_##name(name##_oc, 0, 0, FORMAT_WIDTH, FORMAT_HEIGHT, 0xFFFFFFFF);                                                          \
+        olivec_blit_##name##_to_rgba(olivec_subcanvas(oc, qx, qy, FORMAT_WIDTH, FORMAT_HEIGHT), name##_oc);                                         \
+    } while (0)
+
+void test_pixel_formats(void)
+{
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_fill(oc, ERROR_COLOR);
+
+    // Every quadrant should look the same up to the precision of its format
+    Olivec_Canvas rgba_oc = olivec_subcanvas(oc, 0, 0, FORMAT_WIDTH, FORMAT_HEIGHT);
+    olivec_fill(rgba_oc, BACKGROUND_COLOR);
+    olivec_fill_rect(rgba_oc, FORMAT_WIDTH / 8, FORMAT_HEIGHT / 8, FORMAT_WIDTH / 2, FORMAT_HEIGHT / 4, RED_COLOR);
+    olivec_fill_circle(rgba_oc, FORMAT_WIDTH * 2 / 3, FORMAT_HEIGHT * 2 / 3, FORMAT_WIDTH / 4, GREEN_COLOR);
+    olivec_fill_triangle(rgba_oc, 0, FORMAT_HEIGHT, FORMAT_WIDTH / 2, FORMAT_HEIGHT / 2, FORMAT_WIDTH / 2, FORMAT_HEIGHT, BLUE_COLOR);
+    olivec_draw_line(rgba_oc, 0, 0, FORMAT_WIDTH, FORMAT_HEIGHT, 0xFFFFFFFF);
+
+    DRAW_FORMAT_QUADRANT(bgra, uint32_t, oc, FORMAT_WIDTH, 0);
+    DRAW_FORMAT_QUADRANT(rgb565, uint16_t, oc, 0, FORMAT_HEIGHT);
+    DRAW_FORMAT_QUADRANT(gray8, uint8_t, oc, FORMAT_WIDTH, FORMAT_HEIGHT);
 }
 
 Test_Case test_cases[] = {
+    DEFINE_TEST_CASE(test_fill_span),
     DEFINE_TEST_CASE(test_fill_rect),
+    {
+        .run = test_fill_rect_stream,
+        .file_path = TEST_DIR_PATH "/test_fill_rect.png",
+        .failure_file_path = TEST_DIR_PATH "/test_fill_rect_stream_failure.png",
+    },
     DEFINE_TEST_CASE(test_fill_circle),
+    DEFINE_TEST_CASE(test_fill_circle_aa),
+    DEFINE_TEST_CASE(test_draw_circle),
+    DEFINE_TEST_CASE(test_fill_arc),
+    DEFINE_TEST_CASE(test_fill_ellipse),
     DEFINE_TEST_CASE(test_draw_line),
+    DEFINE_TEST_CASE(test_draw_line_aa),
+    DEFINE_TEST_CASE(test_draw_polyline),
+    DEFINE_TEST_CASE(test_draw_line_pattern),
+    DEFINE_TEST_CASE(test_stroke_polyline),
     DEFINE_TEST_CASE(test_fill_triangle),
+    DEFINE_TEST_CASE(test_subcanvas),
+    DEFINE_TEST_CASE(test_fill_parallel),
+    DEFINE_TEST_CASE(test_fill_rects),
+    DEFINE_TEST_CASE(test_fill_circles),
+    DEFINE_TEST_CASE(test_span_cache),
+    DEFINE_TEST_CASE(test_damage),
+    DEFINE_TEST_CASE(test_extreme_coordinates),
+    DEFINE_TEST_CASE(test_mmap_canvas),
+    DEFINE_TEST_CASE(test_pixel_formats),
 };
 #define TEST_CASES_COUNT (sizeof(test_cases) / sizeof(test_cases[0]))
 
@@ -223,6 +787,15 @@ int main(int argc, char **argv)
     const char *program_path = argv[0];
     bool record = argc >= 2 && strcmp(argv[1], "record") == 0;
 
+    Olivec_Canvas canvas = olivec_canvas_alloc(WIDTH, HEIGHT, 0);
+    if (canvas.pixels == NULL)
+    {
+        fprintf(stderr, "ERROR: could not allocate %dx%d canvas\n", WIDTH, HEIGHT);
+        return 1;
+    }
+    assert(canvas.stride == WIDTH);
+    pixels = canvas.pixels;
+
     for (size_t i = 0; i < TEST_CASES_COUNT; ++i)
     {
         test_cases[i].run();
@@ -237,5 +810,7 @@ int main(int argc, char **argv)
                 return 1;
         }
     }
+
+    olivec_canvas_free(canvas);
     return 0;
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #define HEIGHT 600
 
 uint32_t pixels[WIDTH * HEIGHT];
+Olivec_Damage damage = {0};
 float angle = 0;
 
 void rotate_point(int *x, int *y) {
@@ -11,7 +12,8 @@ void rotate_point(int *x, int *y) {
 
 uint32_t *render(float dt)
 {
-    olivec_fill(pixels, WIDTH, HEIGHT, 0xFF202020);
+    Olivec_Canvas oc = olivec_canvas(pixels, WIDTH, HEIGHT, WIDTH);
+    olivec_damage_begin(&damage, oc, 0xFF202020);
     {
         int x1 = WIDTH / 2, y1 = HEIGHT / 8;
         int x2 = WIDTH / 8, y2 = HEIGHT / 2;
@@ -20,8 +22,20 @@ uint32_t *render(float dt)
         rotate_point(&x2, &y2);
         rotate_point(&x3, &y3);
 
-        olivec_fill_triangle(pixels, WIDTH, HEIGHT, x1, y1, x2, y2, x3, y3, 0xFF2020AA);
+        olivec_fill_triangle(oc, x1, y1, x2, y2, x3, y3, 0xFF2020AA);
     }
+    olivec_damage_end(&damage);
 
     return pixels;
+}
+
+// The regions of the canvas that changed in the last render(), as {x, y, w, h} quadruples of 32-bit ints
+size_t damage_count(void)
+{
+    return damage.present_count;
+}
+
+Olivec_Rect *damage_rects(void)
+{
+    return damage.present;
 }
\ No newline at end of file